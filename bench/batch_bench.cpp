@@ -0,0 +1,207 @@
+// chunk generation throughput of ChunkWorker at several batch sizes.
+//
+// queues the same set of surface chunks (a column grid around the origin,
+// minus the chunks Terrain::bound_occupancy proves empty, like World) into a
+// fresh worker per run and times from start() until the main thread has
+// adopted the last result: fence signalled, totals read, buffers handed back.
+// the batched passes need terrainMode 1 and Config::GPU_HEIGHTFIELD_MESHER;
+// otherwise every batch size runs the per-chunk path.
+//
+// usage: batch_bench [chunks]   (default: 1024; run from the build directory
+// so ../shaders resolves)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+#include "chunk_worker.h"
+#include "config.h"
+#include "gen_job_queue.h"
+#include "gl_shared.h"
+#include "gpu_buffer_pool.h"
+#include "job_queues.h"
+#include "load_shaders.h"
+#include "marching_cubes.h"
+#include "terrain.h"
+#include "worker_types.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int REPEATS = 3;
+    constexpr uint32_t BATCH_SIZES[] = { 1, 8, 32, 128 };
+
+    struct Programs {
+        GLuint density = 0, mcCount = 0, mcEmit = 0, mcStitch = 0;
+        GLuint heights = 0, mcHeightCount = 0, mcHeightEmit = 0;
+    };
+
+    struct RunStats {
+        double seconds = 0.0;
+        uint64_t triangles = 0;
+    };
+
+    std::vector<GenJob> surface_jobs(int chunks) {
+        std::vector<GenJob> jobs;
+        for (int r = 0; int(jobs.size()) < chunks && r < 256; ++r) {
+            for (int x = -r; x <= r && int(jobs.size()) < chunks; ++x) {
+                for (int z = -r; z <= r && int(jobs.size()) < chunks; ++z) {
+                    if (std::max(std::abs(x), std::abs(z)) != r) continue; // ring r only
+                    for (int y = -4; y <= 4 && int(jobs.size()) < chunks; ++y) {
+                        GenJob job;
+                        job.key = { x, y, z, 0 };
+                        job.worldPos = glm::vec3(x * Chunk::CHUNK_WIDTH, y * Chunk::CHUNK_HEIGHT, z * Chunk::CHUNK_DEPTH);
+                        if (Terrain::bound_occupancy(job.worldPos, 1.0f, Config::TERRAIN_MODE) != Terrain::Occupancy::Unknown) continue;
+                        jobs.push_back(job);
+                    }
+                }
+            }
+        }
+        return jobs;
+    }
+
+    // what World::adoptResult does with a result, minus the upload to the renderer
+    uint64_t adopt(GenResult& res, GpuBufferPool& pool) {
+        glClientWaitSync(res.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+        glDeleteSync(res.fence);
+
+        GLuint totals[2] = { res.totalVertices, res.totalIndices };
+        if (res.countOnGpu) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(totals), totals);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        pool.release(GpuBufferPool::Kind::Density, res.densitySSBO);
+        pool.release(GpuBufferPool::Kind::Offsets, res.offsetsSSBO);
+        pool.release(GpuBufferPool::Kind::Counter, res.counterSSBO);
+        pool.freeVertices(res.vertices);
+        return totals[1] / 3;
+    }
+
+    RunStats run(GLFWwindow* workerWindow, const Programs& p, GLuint triSSBO, GLuint edgeSSBO,
+                 GpuBufferPool& pool, const std::vector<GenJob>& jobs, uint32_t batchSize) {
+        GenJobQueue in;
+        SPSCQueue<GenResult> out;
+        ChunkWorker worker(workerWindow, &in, &out, &pool, p.density, p.mcCount, p.mcEmit, p.mcStitch,
+                           p.heights, p.mcHeightCount, p.mcHeightEmit, triSSBO, edgeSSBO);
+        worker.setBatchSize(batchSize);
+        for (const GenJob& job : jobs) {
+            in.push(job);
+        }
+
+        RunStats stats;
+        Clock::time_point t0 = Clock::now();
+        worker.start();
+
+        constexpr size_t BATCH = 16;
+        GenResult batch[BATCH];
+        size_t received = 0;
+        while (received < jobs.size()) {
+            size_t n = out.pop_batch(batch, BATCH);
+            for (size_t i = 0; i < n; ++i) {
+                stats.triangles += adopt(batch[i], pool);
+            }
+            received += n;
+            if (n == 0) {
+                std::this_thread::yield();
+            } else {
+                pool.endFrame();
+            }
+        }
+        stats.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        worker.shutdown();
+        return stats;
+    }
+}
+
+int main(int argc, char** argv) {
+    int chunks = argc > 1 ? std::atoi(argv[1]) : 1024;
+    if (chunks <= 0) {
+        std::fprintf(stderr, "usage: batch_bench [chunks]\n");
+        return 1;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "batch_bench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "no gl 4.4 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        return 1;
+    }
+    GLFWwindow* workerWindow = create_shared_context(window);
+    if (!workerWindow) {
+        std::fprintf(stderr, "no shared worker context\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    GLuint triSSBO = 0, edgeSSBO = 0;
+    glGenBuffers(1, &triSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(triTable), &triTable[0], GL_STATIC_DRAW);
+    glGenBuffers(1, &edgeSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(edgeTable), &edgeTable[0], GL_STATIC_DRAW);
+
+    Programs p;
+    p.density = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/density.comp");
+    p.mcCount = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_count.comp");
+    p.mcEmit = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_emit.comp");
+    p.mcStitch = generate_compute_program("../shaders/mc_stitch.comp");
+    p.heights = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/heights.comp");
+    p.mcHeightCount = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp", "../shaders/heightfield.comp" }, "../shaders/mc_height_count.comp");
+    p.mcHeightEmit = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp", "../shaders/heightfield.comp" }, "../shaders/mc_height_emit.comp");
+
+    std::vector<GenJob> jobs = surface_jobs(chunks);
+    bool batched = Config::TERRAIN_MODE == 1 && Config::GPU_HEIGHTFIELD_MESHER;
+    std::printf("%zu surface chunks, terrainMode %d, %s, best of %d\n", jobs.size(), Config::TERRAIN_MODE,
+                batched ? "batched heightfield passes" : "per-chunk passes only", REPEATS);
+
+    GpuBufferPool pool;
+    std::printf("%-8s %12s %12s %12s\n", "batch", "ms", "chunks/s", "triangles");
+    for (uint32_t size : BATCH_SIZES) {
+        if (size > Config::GPU_HEIGHT_CACHE_COLUMNS) continue; // setBatchSize would clamp it
+        RunStats best;
+        for (int r = 0; r < REPEATS; ++r) {
+            RunStats s = run(workerWindow, p, triSSBO, edgeSSBO, pool, jobs, size);
+            if (r == 0 || s.seconds < best.seconds) best = s;
+        }
+        std::printf("%-8u %12.2f %12.0f %12llu\n", size, best.seconds * 1e3,
+                    double(jobs.size()) / best.seconds, (unsigned long long)best.triangles);
+    }
+
+    GpuBufferPool::Stats ps = pool.stats();
+    std::printf("pool: %llu slabs, %llu scratch buffers\n",
+                (unsigned long long)ps.slabsCreated, (unsigned long long)ps.scratchCreated);
+
+    pool.destroy();
+    GLuint programs[] = { p.density, p.mcCount, p.mcEmit, p.mcStitch, p.heights, p.mcHeightCount, p.mcHeightEmit };
+    for (GLuint prog : programs) {
+        glDeleteProgram(prog);
+    }
+    glDeleteBuffers(1, &triSSBO);
+    glDeleteBuffers(1, &edgeSSBO);
+    glfwDestroyWindow(workerWindow);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
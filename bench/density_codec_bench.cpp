@@ -0,0 +1,132 @@
+// size and speed of the stored density format (DensityCodec).
+//
+// fills the cpu density of every chunk in a column grid around the origin
+// (y -4..4, so the all-air and all-rock chunks a saved world holds are in the
+// mix), then per quantization: bytes per chunk against the raw float grid,
+// how the chunks were encoded, encode and decode MB/s (of float samples), the
+// largest error of samples inside the quantization range, and samples that
+// decoded to the other side of the isolevel (must be 0).
+//
+// usage: density_codec_bench [columns]   (default: 16)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include "chunk.h"
+#include "config.h"
+#include "cpu_backend.h"
+#include "density_codec.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int REPEATS = 5;
+    constexpr double MB = 1024.0 * 1024.0;
+    constexpr size_t GRID_BYTES = DensityCodec::NUM_POINTS * sizeof(float);
+
+    struct Grid {
+        ChunkKey key;
+        std::vector<float> densities;
+    };
+
+    double seconds_since(Clock::time_point t0) {
+        return std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+
+    void run(const std::vector<Grid>& grids, const DensityCodec::Quantization& q) {
+        // encode into one stream
+        std::ostringstream os;
+        Clock::time_point t0 = Clock::now();
+        DensityCodec::Writer writer(os, q);
+        for (const Grid& g : grids) {
+            writer.write(g.key, g.densities.data());
+        }
+        double encodeSec = seconds_since(t0);
+        const std::string stream = os.str();
+
+        // how each chunk came out
+        size_t byEncoding[3] = {};
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(stream.data()) + sizeof(DensityCodec::StreamHeader);
+        for (size_t i = 0; i < grids.size(); ++i) {
+            DensityCodec::RecordHeader h;
+            std::copy(p, p + sizeof(h), reinterpret_cast<uint8_t*>(&h));
+            byEncoding[std::min<size_t>(h.encoding, 2)]++;
+            p += sizeof(h) + h.payloadBytes;
+        }
+
+        // decode the whole stream, best of REPEATS
+        std::vector<float> decoded(DensityCodec::NUM_POINTS);
+        double decodeSec = 0.0;
+        for (int r = 0; r < REPEATS; ++r) {
+            std::istringstream is(stream);
+            t0 = Clock::now();
+            DensityCodec::Reader reader(is);
+            ChunkKey key;
+            size_t n = 0;
+            while (reader.next(key, decoded.data())) ++n;
+            double s = seconds_since(t0);
+            if (n != grids.size() || !reader.ok()) {
+                std::printf("decode failed after %zu chunks\n", n);
+                return;
+            }
+            if (r == 0 || s < decodeSec) decodeSec = s;
+        }
+
+        // accuracy
+        std::istringstream is(stream);
+        DensityCodec::Reader reader(is);
+        double maxError = 0.0;
+        size_t flipped = 0;
+        for (const Grid& g : grids) {
+            ChunkKey key;
+            reader.next(key, decoded.data());
+            for (size_t i = 0; i < decoded.size(); ++i) {
+                float d = g.densities[i];
+                if ((d > q.isolevel) != (decoded[i] > q.isolevel)) flipped++;
+                if (std::fabs(d - q.isolevel) <= q.range) {
+                    maxError = std::max(maxError, double(std::fabs(d - decoded[i])));
+                }
+            }
+        }
+
+        double total = double(grids.size()) * GRID_BYTES / MB;
+        std::printf("%2d bit  %10.0f B/chunk  %6.1fx  uniform %zu raw %zu rle %zu  encode %7.0f MB/s  decode %7.0f MB/s  max err %.5f  flipped %zu\n",
+                    q.bits, double(stream.size()) / double(grids.size()), double(grids.size()) * GRID_BYTES / double(stream.size()),
+                    byEncoding[0], byEncoding[1], byEncoding[2], total / encodeSec, total / decodeSec, maxError, flipped);
+    }
+}
+
+int main(int argc, char** argv) {
+    int columns = argc > 1 ? std::atoi(argv[1]) : 16;
+    if (columns <= 0) {
+        std::fprintf(stderr, "usage: density_codec_bench [columns]\n");
+        return 1;
+    }
+
+    std::vector<Grid> grids;
+    for (int c = 0; c < columns; ++c) {
+        int x = c % 4 - 2, z = c / 4 - 2;
+        for (int y = -4; y <= 4; ++y) {
+            Grid g;
+            g.key = ChunkKey{ x, y, z, 0 };
+            g.densities.resize(DensityCodec::NUM_POINTS);
+            glm::vec3 worldPos(x * Chunk::CHUNK_WIDTH, y * Chunk::CHUNK_HEIGHT, z * Chunk::CHUNK_DEPTH);
+            CpuMesher::fill_density(worldPos, 1.0f, Config::TERRAIN_MODE, g.densities.data());
+            grids.push_back(std::move(g));
+        }
+    }
+
+    std::printf("%zu chunks, terrainMode %d, raw %zu B/chunk, range +-%.1f\n",
+                grids.size(), Config::TERRAIN_MODE, GRID_BYTES, Config::DENSITY_STORE_RANGE);
+    for (int bits : { 8, 16 }) {
+        DensityCodec::Quantization q;
+        q.bits = bits;
+        run(grids, q);
+    }
+    return 0;
+}
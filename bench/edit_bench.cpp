@@ -0,0 +1,220 @@
+// brush-to-mesh latency of sculpting: TerrainEdits::apply plus
+// EditRemesher::remesh of every chunk the brush changed, timed until the gpu
+// has finished the new meshes (fence wait), against a 60 Hz frame.
+//
+// each radius is applied at surface points spread over a few chunks: "cold"
+// is the first stroke at a point (its overlay bricks created), "warm" the
+// strokes after it. the overlay's memory per edited chunk is printed next to
+// what a dense density grid per chunk would take, and the saved edits next to
+// the raw bricks. the saved edits are loaded back, and the bench fails if any
+// edited point's density ends up on the other side of the isolevel.
+//
+// usage: edit_bench [strokes]   (default: 32 per radius; run from the build
+// directory so ../shaders resolves)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "config.h"
+#include "edit_remesher.h"
+#include "gpu_buffer_pool.h"
+#include "load_shaders.h"
+#include "marching_cubes.h"
+#include "terrain_edits.h"
+#include "worker_types.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr float RADII[] = { 2.0f, 4.0f, 8.0f, 16.0f };
+    constexpr int SITES = 4;
+    constexpr double FRAME_MS = 1000.0 / 60.0;
+
+    struct Timing {
+        double total = 0.0;
+        double max = 0.0;
+        int count = 0;
+        size_t chunks = 0;
+
+        void add(double ms, size_t n) {
+            total += ms;
+            max = std::max(max, ms);
+            count++;
+            chunks += n;
+        }
+    };
+
+    // the first point going down from y = 256 where the density turns solid
+    glm::vec3 surface_point(TerrainEdits& edits, int x, int z) {
+        for (int y = 256; y > -256; --y) {
+            if (edits.density(glm::ivec3(x, y, z)) > Config::ISOLEVEL) {
+                return glm::vec3(x, y, z);
+            }
+        }
+        return glm::vec3(x, 0, z);
+    }
+
+    // edited points around the sites whose density is on the other side of
+    // the isolevel in b than in a
+    size_t side_flips(TerrainEdits& a, TerrainEdits& b, const std::vector<glm::vec3>& sites, float radius) {
+        const int r = int(std::ceil(radius));
+        size_t flips = 0;
+        for (const glm::vec3& site : sites) {
+            const glm::ivec3 c(site);
+            for (int z = -r; z <= r; ++z) {
+                for (int y = -r; y <= r; ++y) {
+                    for (int x = -r; x <= r; ++x) {
+                        const glm::ivec3 p = c + glm::ivec3(x, y, z);
+                        if (a.delta(p) == 0.0f) continue;
+                        if ((a.density(p) > Config::ISOLEVEL) != (b.density(p) > Config::ISOLEVEL)) flips++;
+                    }
+                }
+            }
+        }
+        return flips;
+    }
+
+    // one stroke: brush, remesh, wait; returns milliseconds
+    double stroke(TerrainEdits& edits, EditRemesher& remesher, GpuBufferPool& pool,
+                  const Brush& brush, size_t& chunks) {
+        std::vector<ChunkKey> dirty;
+        std::vector<EditRemesher::Request> requests;
+        std::vector<EditRemesher::Mesh> meshes;
+
+        Clock::time_point t0 = Clock::now();
+        edits.apply(brush);
+        edits.takeDirty(dirty);
+        for (const ChunkKey& key : dirty) {
+            // coarser chunks under the brush are in the clipmap's holes, not
+            // loaded: World remeshes only the finest lod there
+            if (key.lod == 0) requests.push_back(EditRemesher::Request{ key, 0 });
+        }
+        remesher.remesh(edits, requests, meshes);
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+        glDeleteSync(fence);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+
+        for (EditRemesher::Mesh& m : meshes) {
+            if (m.vertices.count) pool.freeVertices(m.vertices);
+        }
+        pool.endFrame();
+        chunks = requests.size();
+        return ms;
+    }
+}
+
+int main(int argc, char** argv) {
+    int strokes = argc > 1 ? std::atoi(argv[1]) : 32;
+    if (strokes <= 1) {
+        std::fprintf(stderr, "usage: edit_bench [strokes > 1]\n");
+        return 1;
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "edit_bench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "no gl 4.4 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        return 1;
+    }
+
+    GLuint triSSBO = 0, edgeSSBO = 0;
+    glGenBuffers(1, &triSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(triTable), &triTable[0], GL_STATIC_DRAW);
+    glGenBuffers(1, &edgeSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, edgeSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(edgeTable), &edgeTable[0], GL_STATIC_DRAW);
+
+    GLuint density = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/density.comp");
+    GLuint heights = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/heights.comp");
+    GLuint mcCount = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_count.comp");
+    GLuint mcEmit = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_emit.comp");
+    GLuint mcStitch = generate_compute_program("../shaders/mc_stitch.comp");
+
+    GpuBufferPool pool;
+    bool failed = false;
+    std::printf("%d strokes per radius at %d sites, terrainMode %d, frame budget %.1f ms\n",
+                strokes, SITES, Config::TERRAIN_MODE, FRAME_MS);
+    std::printf("%-8s %8s %12s %12s %12s %12s\n", "radius", "chunks", "cold ms", "warm mean", "warm max", "of frame");
+    for (float radius : RADII) {
+        // fresh state per radius, so its cold strokes really are cold
+        TerrainEdits edits;
+        EditRemesher remesher(density, heights, mcCount, mcEmit, mcStitch, triSSBO, edgeSSBO, &pool);
+        std::vector<glm::vec3> sites;
+        for (int s = 0; s < SITES; ++s) {
+            // the last site sits on a chunk corner, so its brush spans 4+ chunks
+            int x = s == SITES - 1 ? Config::CHUNK_WIDTH : 17 + s * 151;
+            int z = s == SITES - 1 ? Config::CHUNK_DEPTH : 23 + s * 97;
+            sites.push_back(surface_point(edits, x, z));
+        }
+
+        Timing cold, warm;
+        for (int i = 0; i < strokes; ++i) {
+            Brush brush;
+            brush.kind = i % 2 ? Brush::Kind::Subtract : Brush::Kind::Add;
+            brush.center = sites[size_t(i) % sites.size()];
+            brush.radius = radius;
+            brush.strength = 0.5f;
+            size_t chunks = 0;
+            double ms = stroke(edits, remesher, pool, brush, chunks);
+            (i < SITES ? cold : warm).add(ms, chunks);
+        }
+        double warmMean = warm.count ? warm.total / warm.count : 0.0;
+        std::printf("%-8.0f %8.1f %12.2f %12.2f %12.2f %12.2f\n", radius,
+                    double(cold.chunks + warm.chunks) / strokes, cold.total / std::max(cold.count, 1),
+                    warmMean, warm.max, warmMean / FRAME_MS);
+
+        const EditRemesher::Stats& rs = remesher.stats();
+        const double edited = double(std::max<size_t>(edits.chunkCount(), 1));
+        std::printf("         %llu chunks remeshed, %llu bricks uploaded, %.1f KiB uploaded\n",
+                    (unsigned long long)rs.chunks, (unsigned long long)rs.bricksUploaded, rs.bytesUploaded / 1024.0);
+        std::printf("         %zu bricks over %zu chunks: overlay %.1f KiB per edited chunk, dense grid %.1f KiB\n",
+                    edits.brickCount(), edits.chunkCount(), edits.memoryBytes() / edited / 1024.0,
+                    edits.denseBytes() / edited / 1024.0);
+        std::stringstream saved;
+        edits.save(saved);
+        std::printf("         saved %.1f KiB, raw bricks %.1f KiB\n", double(saved.tellp()) / 1024.0,
+                    edits.brickCount() * TerrainEdits::BRICK_POINTS * sizeof(float) / 1024.0);
+        TerrainEdits loaded;
+        if (!loaded.load(saved)) {
+            std::fprintf(stderr, "radius %.0f: saved edits do not load\n", radius);
+            failed = true;
+        } else if (size_t flips = side_flips(edits, loaded, sites, radius)) {
+            std::fprintf(stderr, "radius %.0f: %zu edited points changed sides after a save and load\n", radius, flips);
+            failed = true;
+        }
+        remesher.destroy();
+    }
+
+    pool.destroy();
+    glDeleteProgram(density);
+    glDeleteProgram(heights);
+    glDeleteProgram(mcCount);
+    glDeleteProgram(mcEmit);
+    glDeleteProgram(mcStitch);
+    glDeleteBuffers(1, &triSSBO);
+    glDeleteBuffers(1, &edgeSSBO);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failed ? 1 : 0;
+}
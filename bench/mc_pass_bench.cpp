@@ -0,0 +1,341 @@
+// gpu time of the marching-cubes count and emit passes per chunk.
+//
+// fills the density of a set of surface chunks once (density.comp, like
+// ChunkWorker), then times mc_count.comp and mc_emit.comp on each of them with
+// GL_TIME_ELAPSED queries. every shader directory on the command line is timed
+// on the same densities, so an older revision's passes can be compared with the
+// current ones (density.comp, heights.comp and the snoise.comp / terrain.comp
+// includes always come from the first directory):
+//
+//   mkdir base && for s in mc_count mc_emit; do
+//       git show <rev>:shaders/$s.comp > base/$s.comp; done
+//   mc_pass_bench 64 ../shaders base
+//
+// with terrainMode 1 the first directory's heightfield passes
+// (mc_height_count.comp, mc_height_emit.comp) are timed on the chunks too.
+//
+// usage: mc_pass_bench [chunks] [shader dir ...]   (default: 64 ../shaders)
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "chunk.h"
+#include "config.h"
+#include "gpu_buffer_pool.h"
+#include "load_shaders.h"
+#include "marching_cubes.h"
+#include "worker_types.h"
+
+namespace {
+    constexpr int REPEATS = 5;
+    constexpr GLuint SLAB_SLOTS = 4 * Config::GPU_CHUNK_VERTEX_BUDGET;
+    constexpr GLsizeiptr DENSITY_BYTES =
+        GLsizeiptr(Chunk::CHUNK_WIDTH + 1) * (Chunk::CHUNK_HEIGHT + 1) * (Chunk::CHUNK_DEPTH + 1) * sizeof(float);
+    constexpr GLuint POINT_GROUPS_X = (Chunk::CHUNK_WIDTH + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Y = (Chunk::CHUNK_HEIGHT + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Z = (Chunk::CHUNK_DEPTH + 1 + 7) / 8;
+    constexpr GLuint COLUMN_POINTS = Chunk::CHUNK_WIDTH + 1;
+    constexpr GLuint COLUMN_GROUPS = (COLUMN_POINTS + 7) / 8;
+
+    struct Buffers {
+        GLuint triTable = 0, edgeTable = 0;
+        GLuint counter = 0, offsets = 0, slab = 0;
+        GLuint heights = 0; // one terrainMode 1 height slot per chunk
+        GLuint batch = 0;   // a one-chunk batch for the batched passes
+    };
+
+    struct SurfaceChunk {
+        glm::vec3 worldPos;
+        GLuint density = 0;
+        GLuint heightBase = 0;
+    };
+
+    GLuint make_ssbo(GLsizeiptr bytes, const void* data = nullptr) {
+        GLuint b = 0;
+        glGenBuffers(1, &b);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+        return b;
+    }
+
+    void set_terrain_uniforms(GLuint prog, const SurfaceChunk& c) {
+        glUniform3fv(glGetUniformLocation(prog, "chunkWorldPos"), 1, &c.worldPos[0]);
+        glUniform1i(glGetUniformLocation(prog, "terrainMode"), Config::TERRAIN_MODE);
+        glUniform1f(glGetUniformLocation(prog, "voxelScale"), 1.0f);
+        glUniform1ui(glGetUniformLocation(prog, "heightBase"), c.heightBase);
+    }
+
+    void upload_batch(const SurfaceChunk& c, const Buffers& b) {
+        BatchChunk chunk;
+        chunk.worldPos = glm::vec4(c.worldPos, 1.0f);
+        chunk.heightBase = c.heightBase;
+        chunk.vertexCapacity = SLAB_SLOTS;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b.batch);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(chunk), &chunk);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, b.batch);
+    }
+
+    void fill_heights(GLuint prog, const SurfaceChunk& c, const Buffers& b) {
+        upload_batch(c, b);
+        glUseProgram(prog);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, b.heights);
+        glDispatchCompute(COLUMN_GROUPS, COLUMN_GROUPS, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    void fill_density(GLuint prog, const SurfaceChunk& c, const Buffers& b) {
+        glUseProgram(prog);
+        set_terrain_uniforms(prog, c);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, c.density);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, b.heights);
+        glDispatchCompute(POINT_GROUPS_X, Config::TERRAIN_MODE == 0 ? POINT_GROUPS_Y : 1, POINT_GROUPS_Z);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    void run_count(GLuint prog, GLuint density, const Buffers& b) {
+        GLuint zero[2] = { 0, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b.counter);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+
+        glUseProgram(prog);
+        glUniform1f(glGetUniformLocation(prog, "isolevel"), Config::ISOLEVEL);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, b.triTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, b.edgeTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, b.counter);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, b.offsets);
+        glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // what the last count pass found: {vertices, indices}
+    glm::uvec2 read_totals(const Buffers& b) {
+        GLuint totals[2] = { 0, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b.counter);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(totals), totals);
+        return glm::uvec2(totals[0], totals[1]);
+    }
+
+    void run_emit(GLuint prog, GLuint density, const Buffers& b) {
+        glUseProgram(prog);
+        glUniform1f(glGetUniformLocation(prog, "isolevel"), Config::ISOLEVEL);
+        glUniform1ui(glGetUniformLocation(prog, "baseVertex"), 0);
+        glUniform1ui(glGetUniformLocation(prog, "vertexCapacity"), SLAB_SLOTS);
+        glUniform1ui(glGetUniformLocation(prog, "seams"), 0);
+        glUniform3i(glGetUniformLocation(prog, "seamParity"), 0, 0, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, b.triTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, b.edgeTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, b.slab);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, b.counter);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, b.offsets);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, b.slab);
+        glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // the heightfield passes take the place of count and emit; no density buffer
+    void run_height_count(GLuint prog, const SurfaceChunk& c, const Buffers& b) {
+        GLuint zero[2] = { 0, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b.counter);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+
+        upload_batch(c, b);
+        glUseProgram(prog);
+        glUniform1f(glGetUniformLocation(prog, "isolevel"), Config::ISOLEVEL);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, b.triTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, b.counter);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, b.offsets);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, b.heights);
+        glDispatchCompute(COLUMN_GROUPS, COLUMN_GROUPS, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    void run_height_emit(GLuint prog, const SurfaceChunk& c, const Buffers& b) {
+        upload_batch(c, b);
+        glUseProgram(prog);
+        glUniform1f(glGetUniformLocation(prog, "isolevel"), Config::ISOLEVEL);
+        glUniform1ui(glGetUniformLocation(prog, "slab"), 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, b.triTable);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, b.slab);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, b.counter);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, b.offsets);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, b.slab);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, b.heights);
+        glDispatchCompute(COLUMN_GROUPS, COLUMN_GROUPS, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // gpu nanoseconds spent in fn's commands
+    template<typename Fn>
+    GLuint64 timed(GLuint query, Fn fn) {
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        fn();
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+        return ns;
+    }
+}
+
+int main(int argc, char** argv) {
+    int chunks = argc > 1 ? std::atoi(argv[1]) : 64;
+    std::vector<std::string> dirs;
+    for (int i = 2; i < argc; ++i) {
+        dirs.push_back(argv[i]);
+    }
+    if (dirs.empty()) {
+        dirs.push_back("../shaders");
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "mc_pass_bench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "failed to create a gl context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        glfwTerminate();
+        return 1;
+    }
+
+    std::string snoise = dirs[0] + "/snoise.comp";
+    std::string terrain = dirs[0] + "/terrain.comp";
+    std::string heightfield = dirs[0] + "/heightfield.comp";
+    std::string chunkBatch = dirs[0] + "/chunk_batch.comp";
+    auto compile = [&](const std::string& path) {
+        return generate_compute_program({ snoise.c_str(), terrain.c_str() }, path.c_str());
+    };
+    GLuint densityProg = compile(dirs[0] + "/density.comp");
+    GLuint heightsProg = generate_compute_program({ chunkBatch.c_str(), snoise.c_str(), terrain.c_str() },
+                                                  (dirs[0] + "/heights.comp").c_str());
+
+    Buffers b;
+    b.triTable = make_ssbo(sizeof(triTable), &triTable[0]);
+    b.edgeTable = make_ssbo(sizeof(edgeTable), &edgeTable[0]);
+    b.counter = make_ssbo(2 * sizeof(GLuint));
+    b.offsets = make_ssbo(GLsizeiptr(DENSITY_BYTES / sizeof(float)) * 2 * sizeof(GLuint));
+    b.slab = make_ssbo(GLsizeiptr(SLAB_SLOTS) * 2 * sizeof(GLuint));
+    b.heights = make_ssbo(GLsizeiptr(std::max(chunks, 1)) * COLUMN_POINTS * COLUMN_POINTS * sizeof(float));
+    b.batch = make_ssbo(sizeof(BatchChunk));
+
+    // surface chunks only: walk a column grid around the origin and keep the
+    // chunks the current count pass finds triangles in
+    GLuint probeCount = compile(dirs[0] + "/mc_count.comp");
+    std::vector<SurfaceChunk> surface;
+    SurfaceChunk candidate;
+    candidate.density = make_ssbo(DENSITY_BYTES);
+    for (int r = 0; int(surface.size()) < chunks && r < 64; ++r) {
+        for (int x = -r; x <= r && int(surface.size()) < chunks; ++x) {
+            for (int z = -r; z <= r && int(surface.size()) < chunks; ++z) {
+                if (std::abs(x) != r && std::abs(z) != r) continue; // ring r only
+                for (int y = -4; y <= 4 && int(surface.size()) < chunks; ++y) {
+                    candidate.worldPos = glm::vec3(x, y, z) * glm::vec3(Chunk::CHUNK_WIDTH, Chunk::CHUNK_HEIGHT, Chunk::CHUNK_DEPTH);
+                    candidate.heightBase = GLuint(surface.size()) * COLUMN_POINTS * COLUMN_POINTS;
+                    if (Config::TERRAIN_MODE == 1) {
+                        fill_heights(heightsProg, candidate, b);
+                    }
+                    fill_density(densityProg, candidate, b);
+                    run_count(probeCount, candidate.density, b);
+                    if (read_totals(b).y == 0) continue;
+                    surface.push_back(candidate);
+                    candidate.density = make_ssbo(DENSITY_BYTES);
+                }
+            }
+        }
+    }
+    glDeleteBuffers(1, &candidate.density);
+    glDeleteProgram(probeCount);
+
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    std::printf("%zu surface chunks, %d repeats\n", surface.size(), REPEATS);
+
+    auto report = [&](const std::string& name, GLuint64 countNs, GLuint64 emitNs, uint64_t vertices, uint64_t indices, int overflowed) {
+        double runs = double(REPEATS) * double(surface.size());
+        std::printf("%-24s count %8.1f us/chunk   emit %8.1f us/chunk   %8.0f verts %8.0f indices/chunk\n",
+                    name.c_str(), countNs / runs / 1e3, emitNs / runs / 1e3,
+                    vertices / double(surface.size()), indices / double(surface.size()));
+        if (overflowed) {
+            std::printf("  %d chunks did not fit the slab; their emit wrote nothing\n", overflowed);
+        }
+    };
+
+    for (const std::string& dir : dirs) {
+        GLuint countProg = compile(dir + "/mc_count.comp");
+        GLuint emitProg = compile(dir + "/mc_emit.comp");
+
+        GLuint64 countNs = 0, emitNs = 0;
+        uint64_t vertices = 0, indices = 0;
+        int overflowed = 0;
+        for (int rep = 0; rep < REPEATS; ++rep) {
+            for (const SurfaceChunk& c : surface) {
+                countNs += timed(query, [&]{ run_count(countProg, c.density, b); });
+                glm::uvec2 totals = read_totals(b);
+                emitNs += timed(query, [&]{ run_emit(emitProg, c.density, b); });
+                if (rep == 0) {
+                    vertices += totals.x;
+                    indices += totals.y;
+                    overflowed += mesh_slots(totals.x, totals.y) > SLAB_SLOTS;
+                }
+            }
+        }
+        report(dir, countNs, emitNs, vertices, indices, overflowed);
+        glDeleteProgram(countProg);
+        glDeleteProgram(emitProg);
+    }
+
+    // same chunks through the heightfield passes: same triangles, other order
+    if (Config::TERRAIN_MODE == 1) {
+        auto compileHeightfield = [&](const std::string& path) {
+            return generate_compute_program({ chunkBatch.c_str(), snoise.c_str(), terrain.c_str(), heightfield.c_str() }, path.c_str());
+        };
+        GLuint countProg = compileHeightfield(dirs[0] + "/mc_height_count.comp");
+        GLuint emitProg = compileHeightfield(dirs[0] + "/mc_height_emit.comp");
+
+        GLuint64 countNs = 0, emitNs = 0;
+        uint64_t vertices = 0, indices = 0;
+        int overflowed = 0;
+        for (int rep = 0; rep < REPEATS; ++rep) {
+            for (const SurfaceChunk& c : surface) {
+                countNs += timed(query, [&]{ run_height_count(countProg, c, b); });
+                glm::uvec2 totals = read_totals(b);
+                emitNs += timed(query, [&]{ run_height_emit(emitProg, c, b); });
+                if (rep == 0) {
+                    vertices += totals.x;
+                    indices += totals.y;
+                    overflowed += mesh_slots(totals.x, totals.y) > SLAB_SLOTS;
+                }
+            }
+        }
+        report(dirs[0] + " heightfield", countNs, emitNs, vertices, indices, overflowed);
+        glDeleteProgram(countProg);
+        glDeleteProgram(emitProg);
+    }
+
+    glDeleteQueries(1, &query);
+    for (const SurfaceChunk& c : surface) {
+        glDeleteBuffers(1, &c.density);
+    }
+    GLuint shared[] = { b.triTable, b.edgeTable, b.counter, b.offsets, b.slab, b.heights, b.batch };
+    glDeleteBuffers(7, shared);
+    glDeleteProgram(heightsProg);
+    glDeleteProgram(densityProg);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
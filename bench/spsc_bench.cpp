@@ -0,0 +1,134 @@
+// SPSCQueue (lock-free ring) vs the previous mutex + std::queue implementation.
+// one producer thread pushes timestamped items, one consumer pops them and
+// records push-to-pop latency. reports throughput and latency percentiles.
+//
+// usage: spsc_bench [items per run]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "job_queues.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // the queue SPSCQueue replaced, kept here as the baseline
+    template<typename T>
+    class MutexQueue {
+        std::mutex m;
+        std::queue<T> q;
+    public:
+        void push(T v) {
+            std::lock_guard<std::mutex> lk(m);
+            q.push(std::move(v));
+        }
+        bool try_pop(T& out) {
+            std::lock_guard<std::mutex> lk(m);
+            if (q.empty()) {
+                return false;
+            }
+            out = std::move(q.front());
+            q.pop();
+            return true;
+        }
+    };
+
+    struct Item {
+        int64_t pushedNs = 0;
+        uint64_t payload[3] = {}; // roughly GenResult-sized handles
+    };
+
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    struct Result {
+        double opsPerSec;
+        std::vector<int64_t> latencies;
+    };
+
+    template<typename PushFn, typename PopFn>
+    Result run(size_t items, PushFn push, PopFn pop) {
+        std::vector<int64_t> latencies;
+        latencies.reserve(items);
+
+        auto t0 = Clock::now();
+        std::thread producer([&]{
+            for (size_t i = 0; i < items; ++i) {
+                Item it;
+                it.pushedNs = now_ns();
+                it.payload[0] = i;
+                push(it);
+            }
+        });
+
+        size_t received = 0;
+        while (received < items) {
+            received += pop([&](const Item& it){ latencies.push_back(now_ns() - it.pushedNs); });
+        }
+        producer.join();
+        auto t1 = Clock::now();
+
+        return { items / std::chrono::duration<double>(t1 - t0).count(), std::move(latencies) };
+    }
+
+    void report(const char* name, Result r) {
+        std::sort(r.latencies.begin(), r.latencies.end());
+        auto pct = [&](double p) {
+            size_t i = std::min(r.latencies.size() - 1, size_t(p * double(r.latencies.size())));
+            return double(r.latencies[i]) / 1000.0;
+        };
+        std::printf("%-22s %12.0f ops/s   p50 %8.2f us   p99 %8.2f us   p99.9 %8.2f us   max %9.2f us\n",
+                    name, r.opsPerSec, pct(0.50), pct(0.99), pct(0.999), double(r.latencies.back()) / 1000.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t items = argc > 1 ? size_t(std::atoll(argv[1])) : 2000000;
+
+    {
+        MutexQueue<Item> q;
+        report("mutex queue", run(items,
+            [&](Item& it){ q.push(it); },
+            [&](auto&& onItem) -> size_t {
+                Item it;
+                if (!q.try_pop(it)) return 0;
+                onItem(it);
+                return 1;
+            }));
+    }
+
+    {
+        SPSCQueue<Item> q(1024);
+        report("spsc ring", run(items,
+            [&](Item& it){ q.push(it); },
+            [&](auto&& onItem) -> size_t {
+                Item it;
+                if (!q.try_pop(it)) return 0;
+                onItem(it);
+                return 1;
+            }));
+    }
+
+    {
+        // consumer drains up to 16 per index update, like World::collectFinished
+        SPSCQueue<Item> q(1024);
+        report("spsc ring, pop_batch", run(items,
+            [&](Item& it){ q.push(it); },
+            [&](auto&& onItem) -> size_t {
+                Item batch[16];
+                size_t n = q.pop_batch(batch, 16);
+                for (size_t i = 0; i < n; ++i) onItem(batch[i]);
+                return n;
+            }));
+    }
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+// cost of World::update() per frame at several view distances.
+//
+// "index" rows replay update()'s bookkeeping (unload walk, then one lookup per
+// chunk in the load box, inserting whatever is missing as if it loaded at once)
+// against the old std::map + std::unordered_set pair and against ChunkMap.
+// "world" rows time the real World::update(), including the job queue and the
+// lod rings (Config::LOD_LEVELS); no generator runs, so every tracked chunk
+// stays Requested. view distance sizes the coarsest lod there.
+//
+// each case runs a stationary phase (player idle, pure lookup cost) and a
+// moving phase (player crosses one chunk boundary every frame).
+//
+// usage: world_update_bench [frames per phase]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+#include "chunk_map.h"
+#include "gen_job_queue.h"
+#include "job_queues.h"
+#include "world.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // vertical load range of the uniform grid World::update() used before lod
+    constexpr int LOAD_Y = 4;
+
+    bool out_of_range(const glm::ivec3& c, const glm::ivec3& player, int r) {
+        return abs(c.x - player.x) > r || abs(c.y - player.y) > r || abs(c.z - player.z) > r;
+    }
+
+    // the containers ChunkMap replaced, kept here as the baseline
+    struct Vec3Compare {
+        bool operator()(const glm::ivec3& a, const glm::ivec3& b) const {
+            if (a.x != b.x) return a.x < b.x;
+            if (a.y != b.y) return a.y < b.y;
+            return a.z < b.z;
+        }
+    };
+
+    struct LegacyIndex {
+        std::map<glm::ivec3, int, Vec3Compare> active;
+        std::unordered_set<long long> requested;
+
+        void frame(const glm::ivec3& player, int r) {
+            std::vector<glm::ivec3> unload;
+            for (auto const& [coord, v] : active) {
+                if (out_of_range(coord, player, r)) unload.push_back(coord);
+            }
+            for (const auto& coord : unload) {
+                active.erase(coord);
+                requested.erase(key64(coord.x, coord.y, coord.z));
+            }
+            for (int x = -r; x <= r; x++) {
+                for (int y = -LOAD_Y; y <= LOAD_Y; y++) {
+                    for (int z = -r; z <= r; z++) {
+                        glm::ivec3 c = player + glm::ivec3(x, y, z);
+                        if (active.find(c) != active.end()) continue;
+                        long long k = key64(c.x, c.y, c.z);
+                        if (requested.count(k)) continue;
+                        requested.insert(k);
+                        active.emplace(c, 0);
+                    }
+                }
+            }
+        }
+    };
+
+    struct FlatIndex {
+        ChunkMap chunks;
+
+        void frame(const glm::ivec3& player, int r) {
+            std::vector<long long> unload;
+            for (auto& e : chunks) {
+                if (out_of_range(glm::ivec3(e.coord.x, e.coord.y, e.coord.z), player, r)) unload.push_back(key64(e.coord));
+            }
+            for (long long k : unload) {
+                chunks.erase(k);
+            }
+            for (int x = -r; x <= r; x++) {
+                for (int y = -LOAD_Y; y <= LOAD_Y; y++) {
+                    for (int z = -r; z <= r; z++) {
+                        glm::ivec3 c = player + glm::ivec3(x, y, z);
+                        long long k = key64(c.x, c.y, c.z);
+                        if (chunks.find(k)) continue;
+                        chunks.insert(ChunkKey{c.x, c.y, c.z}, glm::vec3(c)).state = ChunkMap::State::Loaded;
+                    }
+                }
+            }
+        }
+    };
+
+    glm::vec3 chunk_center(const glm::ivec3& c) {
+        return (glm::vec3(c) + 0.5f) * glm::vec3(Config::CHUNK_WIDTH, Config::CHUNK_HEIGHT, Config::CHUNK_DEPTH);
+    }
+
+    // runs frameFn(playerChunk) once to fill, then times the two phases;
+    // countFn reports how many chunks the fill left tracked
+    template<typename FrameFn, typename CountFn>
+    void time_phases(const char* name, int r, int frames, FrameFn frameFn, CountFn countFn) {
+        glm::ivec3 player(0);
+        frameFn(player);
+        size_t tracked = countFn();
+
+        auto t0 = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            frameFn(player);
+        }
+        auto t1 = Clock::now();
+        for (int i = 0; i < frames; ++i) {
+            player.x += 1;
+            frameFn(player);
+        }
+        auto t2 = Clock::now();
+
+        double idleUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / frames;
+        double moveUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / frames;
+        std::printf("%-14s vd %2d  %7zu chunks   idle %10.1f us/frame   moving %10.1f us/frame\n",
+                    name, r, tracked, idleUs, moveUs);
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 50;
+
+    for (int r : { 6, 16, 32 }) {
+        {
+            LegacyIndex idx;
+            time_phases("index, legacy", r, frames, [&](const glm::ivec3& p){ idx.frame(p, r); },
+                        [&]{ return idx.active.size(); });
+        }
+        {
+            FlatIndex idx;
+            time_phases("index, flat", r, frames, [&](const glm::ivec3& p){ idx.frame(p, r); },
+                        [&]{ return idx.chunks.size(); });
+        }
+        {
+            GenJobQueue genIn;
+            SPSCQueue<GenResult> genOut;
+            World world(0, 0, 0, &genIn, &genOut, nullptr, nullptr);
+            world.setViewDistance(r);
+            const glm::vec3 viewDir(1.0f, 0.0f, 0.0f);
+            time_phases("world update", r, frames, [&](const glm::ivec3& p){ world.update(chunk_center(p), viewDir); },
+                        [&]{ return world.chunkCount(); });
+        }
+    }
+    return 0;
+}
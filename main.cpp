@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <optional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -17,10 +21,19 @@
 
 #include "chunk.h"
 #include "world.h"
+#include "chunk_renderer.h"
+#include "hiz_pyramid.h"
 #include "chunk_worker.h"
+#include "chunk_scheduler.h"
 #include "marching_cubes.h"
 
 #include "job_queues.h"
+#include "gen_job_queue.h"
+#include "gpu_buffer_pool.h"
+#include "mesh_cache.h"
+#include "profiler.h"
+#include "edit_remesher.h"
+#include "terrain_edits.h"
 #include "worker_types.h"
 
 
@@ -28,6 +41,7 @@ float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 void processInput(GLFWwindow* window, Camera& camera, float dt);
+void processBrush(GLFWwindow* window, const Camera& camera, World& world, float dt);
 GLuint loadTerrainTexture(const char* path);
 
 int main() {
@@ -56,9 +70,20 @@ int main() {
 
     // compile shaders
     unsigned int shaderProgram = generate_shader_program();
-    unsigned int densityComputeProgram = generate_compute_program("../shaders/snoise.comp", "../shaders/density.comp");
-    unsigned int mcCountComputeProgram = generate_compute_program("../shaders/mc_count.comp");
-    unsigned int mcEmitComputeProgram = generate_compute_program("../shaders/mc_emit.comp");
+    unsigned int densityComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/density.comp");
+    unsigned int mcCountComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_count.comp");
+    unsigned int mcEmitComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_emit.comp");
+    unsigned int mcStitchComputeProgram = generate_compute_program("../shaders/mc_stitch.comp");
+    unsigned int heightsComputeProgram = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/heights.comp");
+    unsigned int mcHeightCountComputeProgram = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp", "../shaders/heightfield.comp" }, "../shaders/mc_height_count.comp");
+    unsigned int mcHeightEmitComputeProgram = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp", "../shaders/heightfield.comp" }, "../shaders/mc_height_emit.comp");
+    unsigned int editDensityComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/density.comp");
+    unsigned int editHeightsComputeProgram = generate_compute_program({ "../shaders/chunk_batch.comp", "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/heights.comp");
+    unsigned int editMcCountComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_count.comp");
+    unsigned int editMcEmitComputeProgram = generate_compute_program({ "../shaders/snoise.comp", "../shaders/terrain.comp" }, "../shaders/mc_emit.comp");
+    unsigned int editMcStitchComputeProgram = generate_compute_program("../shaders/mc_stitch.comp");
+    unsigned int cullComputeProgram = generate_compute_program("../shaders/cull.comp");
+    unsigned int hizBuildComputeProgram = generate_compute_program("../shaders/hiz_build.comp");
     auto U = get_locations(shaderProgram);
 
     // load noise texture for terrain coloring
@@ -77,29 +102,83 @@ int main() {
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(aniso, 8.0f));
 
     // setup worker for multi-threaded chunk jobs
-    BlockingQueue<GenJob> genIn;
+    GenJobQueue genIn;
     SPSCQueue<GenResult> genOut;
-    ChunkWorker worker(worker_window, &genIn, &genOut, densityComputeProgram, mcCountComputeProgram, mcEmitComputeProgram, g_triSSBO, g_edgeSSBO);
-    worker.start();
+    GpuBufferPool gpuBuffers;
+    std::optional<Profiler> profiler;
+    if (Config::PROFILER) {
+        profiler.emplace();
+    }
+    Profiler::Thread* prof = profiler ? profiler->thread("main") : nullptr;
+    ChunkWorker worker(worker_window, &genIn, &genOut, &gpuBuffers, densityComputeProgram, mcCountComputeProgram, mcEmitComputeProgram, mcStitchComputeProgram,
+                       heightsComputeProgram, mcHeightCountComputeProgram, mcHeightEmitComputeProgram, g_triSSBO, g_edgeSSBO);
+    std::optional<ChunkScheduler> cpuScheduler;
+    if (Config::GEN_BACKEND == Config::GenBackend::CPU) {
+        cpuScheduler.emplace(&genIn, &genOut);
+        cpuScheduler->start();
+    } else {
+        worker.setProfiler(profiler ? &*profiler : nullptr);
+        worker.start();
+    }
 
     {
         // create world
-        World world(densityComputeProgram, mcCountComputeProgram, mcEmitComputeProgram, &genIn, &genOut);
+        ChunkRenderer chunkRenderer(cullComputeProgram);
+        HiZPyramid hiz(hizBuildComputeProgram);
+        std::optional<MeshCache> meshCache;
+        if (Config::MESH_CACHE) {
+            meshCache.emplace();
+        }
+        World world(densityComputeProgram, mcCountComputeProgram, mcEmitComputeProgram, &genIn, &genOut, &gpuBuffers, &chunkRenderer,
+                    meshCache ? &*meshCache : nullptr);
+
+        // sculpting, with the edits of the last session. the remesher runs on
+        // this thread, so it gets its own programs (uniforms are program state)
+        TerrainEdits edits;
+        EditRemesher remesher(editDensityComputeProgram, editHeightsComputeProgram, editMcCountComputeProgram, editMcEmitComputeProgram,
+                              editMcStitchComputeProgram, g_triSSBO, g_edgeSSBO, &gpuBuffers);
+        {
+            std::ifstream in(Config::EDITS_FILE, std::ios::binary);
+            if (in.is_open() && !edits.load(in)) {
+                std::cerr << "Failed to load edits from " << Config::EDITS_FILE << "\n";
+            }
+        }
+        world.enableEditing(&edits, &remesher);
 
         // sun-like lighting
         glm::vec3 lightColor(1.0f, 0.95f, 0.9f);
         glm::vec3 lightPos(24.0f, 50.0f, 24.0f);
 
+        float lastStatsTime = 0.0f;
+        bool captureHeld = false;
+
         // render loop
         while (!glfwWindowShouldClose(window)) {
             float currentFrame = static_cast<float>(glfwGetTime());
             deltaTime = currentFrame - lastFrame;
             lastFrame = currentFrame;
+            if (profiler) profiler->beginFrame();
 
             processInput(window, camera, deltaTime);
-            world.update(camera.Position);
-            world.collectFinished();
-
+            {
+                ProfileZone zone(prof, "World::update");
+                world.update(camera.Position, camera.Front);
+            }
+            {
+                ProfileZone zone(prof, "World::collectFinished");
+                world.collectFinished();
+            }
+            processBrush(window, camera, world, deltaTime);
+            {
+                ProfileZone zone(prof, "World::remeshEdited");
+                GpuProfileZone gpuZone(prof, "edit remesh");
+                world.remeshEdited();
+            }
+
+            if (prof) {
+                prof->begin("render");
+                prof->beginGpu("render");
+            }
             // sky blue color
             glClearColor(0.5f, 0.7f, 0.9f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -119,19 +198,127 @@ int main() {
             glUniform3fv(U.uLightPos, 1, &lightPos[0]);
             glUniform3fv(U.uViewPos, 1, &camera.Position[0]);
 
-            Frustum fr = make_frustum(projection * view);
-            world.render(shaderProgram, fr, U.uModel);
-
-            glfwSwapBuffers(window);
+            glm::mat4 viewProj = projection * view;
+            Frustum fr = make_frustum(viewProj);
+            world.render(fr, Config::GPU_OCCLUSION_CULLING ? &hiz : nullptr);
+            if (prof) {
+                prof->endGpu();
+                prof->end();
+            }
+            if (Config::GPU_OCCLUSION_CULLING) {
+                // occluders for the next frame's cull pass
+                ProfileZone zone(prof, "HiZPyramid::build");
+                GpuProfileZone gpuZone(prof, "hiz build");
+                int fbWidth = 0, fbHeight = 0;
+                glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+                hiz.build(fbWidth, fbHeight, viewProj);
+            }
+            gpuBuffers.endFrame();
+
+            // culling stats in the title, once a second
+            if (currentFrame - lastStatsTime >= 1.0f) {
+                lastStatsTime = currentFrame;
+                const ChunkRenderer::CullStats& cs = chunkRenderer.lastCullStats();
+                char title[160];
+                std::snprintf(title, sizeof(title), "engineee | chunks %u drawn, %u frustum-culled, %u occluded | %.2fM tris drawn, %.2fM culled",
+                              cs.chunksDrawn, cs.frustumCulled, cs.occlusionCulled,
+                              cs.trianglesDrawn / 1e6, cs.trianglesCulled / 1e6);
+                glfwSetWindowTitle(window, title);
+            }
+
+            {
+                ProfileZone zone(prof, "swap");
+                glfwSwapBuffers(window);
+            }
             glfwPollEvents();
+
+            if (profiler) {
+                prof->collectGpu();
+                profiler->endFrame();
+
+                // F12: what the profiler still holds as a chrome trace
+                const bool capture = glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS;
+                if (capture && !captureHeld) {
+                    std::ofstream out(Config::PROFILER_TRACE_FILE);
+                    if (profiler->exportChromeTrace(out)) {
+                        std::cout << "profiler: trace written to " << Config::PROFILER_TRACE_FILE << "\n";
+                    } else {
+                        std::cerr << "Failed to write " << Config::PROFILER_TRACE_FILE << "\n";
+                    }
+                }
+                captureHeld = capture;
+            }
+        }
+
+        const World::Stats& worldStats = world.stats();
+        std::cout << "world: " << worldStats.jobsQueued << " generation jobs queued, "
+                  << worldStats.jobsSkipped << " chunks skipped as all air or rock, "
+                  << worldStats.cacheHits << " loaded from the mesh cache\n";
+        const size_t editedChunks = std::max<size_t>(edits.chunkCount(), 1);
+        std::cout << "edits: " << edits.brickCount() << " bricks over " << edits.chunkCount() << " chunks, overlay "
+                  << edits.memoryBytes() / editedChunks / 1024 << " KiB per edited chunk (dense grid "
+                  << edits.denseBytes() / editedChunks / 1024 << " KiB), "
+                  << worldStats.chunksRemeshed << " chunks remeshed, brush to mesh " << worldStats.lastEditMs << " ms last, "
+                  << worldStats.maxEditMs << " ms max\n";
+        if (edits.brickCount() > 0) {
+            std::ofstream out(Config::EDITS_FILE, std::ios::binary);
+            if (!edits.save(out)) {
+                std::cerr << "Failed to save edits to " << Config::EDITS_FILE << "\n";
+            }
+        }
+        remesher.destroy();
+        if (meshCache) {
+            const MeshCache::Stats& cacheStats = meshCache->stats();
+            std::cout << "mesh cache: " << cacheStats.hits << " hits (" << cacheStats.bytesRead / (1024 * 1024) << " MiB), "
+                      << cacheStats.misses << " misses, " << cacheStats.stores << " meshes stored ("
+                      << cacheStats.bytesWritten / (1024 * 1024) << " MiB), " << cacheStats.regionsOpened << " regions opened\n";
         }
     }
 
     worker.shutdown();
+    if (cpuScheduler) {
+        cpuScheduler->shutdown();
+    }
+    const HeightCache::Stats& heightStats = worker.heightCacheStats();
+    if (heightStats.hits + heightStats.misses > 0) {
+        std::cout << "height cache: " << heightStats.misses << " columns computed, "
+                  << heightStats.hits << " chunks served from the cache\n";
+    }
+    GpuBufferPool::Stats poolStats = gpuBuffers.stats();
+    std::cout << "gpu buffer pool: " << poolStats.scratchCreated << " scratch buffers created, "
+              << poolStats.scratchReused << " reused, " << poolStats.slabsCreated << " vertex slabs, "
+              << poolStats.vertexAllocs << " vertex allocs\n";
+    gpuBuffers.destroy();
+    if (profiler) {
+        std::vector<Profiler::Frame> frames = profiler->frames(Config::PROFILER_FRAMES);
+        double total = 0.0, worst = 0.0;
+        for (const Profiler::Frame& f : frames) {
+            total += f.durationNs / 1e6;
+            worst = std::max(worst, f.durationNs / 1e6);
+        }
+        if (!frames.empty()) {
+            std::cout << "profiler: last " << frames.size() << " frames " << total / frames.size() << " ms mean, "
+                      << worst << " ms max\n";
+        }
+        prof->collectGpu(true);
+        prof->destroy();
+    }
+
     glDeleteProgram(shaderProgram);
     glDeleteProgram(densityComputeProgram);
     glDeleteProgram(mcCountComputeProgram);
     glDeleteProgram(mcEmitComputeProgram);
+    glDeleteProgram(mcStitchComputeProgram);
+    glDeleteProgram(heightsComputeProgram);
+    glDeleteProgram(mcHeightCountComputeProgram);
+    glDeleteProgram(mcHeightEmitComputeProgram);
+    glDeleteProgram(editDensityComputeProgram);
+    glDeleteProgram(editHeightsComputeProgram);
+    glDeleteProgram(editMcCountComputeProgram);
+    glDeleteProgram(editMcEmitComputeProgram);
+    glDeleteProgram(editMcStitchComputeProgram);
+    glDeleteProgram(cullComputeProgram);
+    glDeleteProgram(hizBuildComputeProgram);
     glDeleteBuffers(1, &g_triSSBO);
     glDeleteBuffers(1, &g_edgeSSBO);
     glDeleteTextures(1, &noiseTex);
@@ -157,6 +344,26 @@ void processInput(GLFWwindow *window, Camera& camera, float dt) {
         camera.ProcessKeyboard(DOWN, dt);
 }
 
+// sculpt at the point EDIT_BRUSH_REACH ahead of the camera while held:
+// left mouse adds terrain, right mouse removes it, F flattens, R smooths
+void processBrush(GLFWwindow* window, const Camera& camera, World& world, float dt) {
+    Brush brush;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+        brush.kind = Brush::Kind::Add;
+    else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+        brush.kind = Brush::Kind::Subtract;
+    else if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+        brush.kind = Brush::Kind::Flatten;
+    else if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+        brush.kind = Brush::Kind::Smooth;
+    else
+        return;
+
+    brush.center = camera.Position + camera.Front * Config::EDIT_BRUSH_REACH;
+    brush.strength = Config::EDIT_BRUSH_STRENGTH * dt;
+    world.applyBrush(brush);
+}
+
 GLuint loadTerrainTexture(const char* path) {
     int w=0, h=0, comp=0;
     stbi_uc* data = stbi_load(path, &w, &h, &comp, 1);
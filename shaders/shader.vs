@@ -1,16 +1,18 @@
 #version 430 core
 layout (location = 0) in uint aPosPacked;
 layout (location = 1) in uint aNormalPacked;
+layout (location = 2) in vec4 aChunkOrigin; // per instance, selected by baseInstance; w = voxel scale
  
 out vec3 fragPos;
 out vec3 normal;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 const uint POSITION_BITS = 10u;
-const float POS_Q_MAX = float((1u << POSITION_BITS) - 1u);
+// an even step count: a coarser lod's step is exactly two of a finer one,
+// so vertices on the chunk seams land on both lattices
+const float POS_Q_MAX = float((1u<<POSITION_BITS)-2u);
 
 vec3 decode_pos(uint p) {
     uint x = (p & 1023u);
@@ -39,10 +41,10 @@ void main()
 {
     vec3 localPos = decode_pos(aPosPacked);
     vec3 N = oct_to_vec3(aNormalPacked);
-    vec4 worldPos = model * vec4(localPos, 1.0f);
+    vec4 worldPos = vec4(localPos * aChunkOrigin.w + aChunkOrigin.xyz, 1.0f);
     fragPos = worldPos.xyz;
 
-    normal = normalize(mat3(model) * N);
+    normal = N;
 
     gl_Position = projection * view * worldPos;
 }
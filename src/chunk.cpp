@@ -1,4 +1,5 @@
 #include "chunk.h"
+#include "chunk_renderer.h"
 
 #include "glm/geometric.hpp"
 #include "marching_cubes.h"
@@ -23,42 +24,51 @@ namespace {
   };
 };
 
-// initialize chunk data and generate chunk mesh with compute shaders
-Chunk::Chunk(glm::vec3 chunkPosition) : chunkPos(chunkPosition), VAO(0), vertexSSBO(0), indirectBuffer(0) { }
+// initialize chunk data; the mesh arrives later through adoptMesh
+Chunk::Chunk(glm::vec3 chunkPosition, float voxelScale_) : chunkPos(chunkPosition), voxelScale(voxelScale_), vertices(), pool(nullptr), renderer(nullptr), slot(0) { }
+
+Chunk::Chunk(Chunk&& other) noexcept
+  : chunkPos(other.chunkPos), voxelScale(other.voxelScale), vertices(other.vertices), pool(other.pool), renderer(other.renderer), slot(other.slot) {
+  other.vertices = VertexRange{};
+  other.renderer = nullptr;
+}
+
+Chunk& Chunk::operator=(Chunk&& other) noexcept {
+  if (this != &other) {
+    release();
+    chunkPos = other.chunkPos;
+    voxelScale = other.voxelScale;
+    vertices = other.vertices;
+    pool = other.pool;
+    renderer = other.renderer;
+    slot = other.slot;
+    other.vertices = VertexRange{};
+    other.renderer = nullptr;
+  }
+  return *this;
+}
 
 // cleanup
 Chunk::~Chunk() {
-  if (VAO) {
-    glDeleteVertexArrays(1, &VAO);
-  }
-  if (vertexSSBO) {
-    glDeleteBuffers(1, &vertexSSBO);
-  }
-  if (indirectBuffer) {
-    glDeleteBuffers(1, &indirectBuffer);
-  }
+  release();
 }
 
-void Chunk::adoptPrebuilt(GLuint vao_, GLuint vbo_, GLuint indirect_) {
-  if (VAO) {
-    glDeleteVertexArrays(1, &VAO);
-  }
-  if (vertexSSBO) {
-    glDeleteBuffers(1, &vertexSSBO);
+void Chunk::release() {
+  if (renderer) {
+    renderer->removeChunk(slot);
   }
-  if (indirectBuffer) {
-    glDeleteBuffers(1, &indirectBuffer);
+  if (pool) {
+    pool->freeVertices(vertices);
   }
-
-  VAO = vao_;
-  vertexSSBO = vbo_;
-  indirectBuffer = indirect_;
+  vertices = VertexRange{};
+  renderer = nullptr;
 }
 
-void Chunk::renderRaw() {
-  glBindVertexArray(this->VAO);
-  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
-  glDrawArraysIndirect(GL_TRIANGLES, 0);
-  glBindVertexArray(0);
-  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+void Chunk::adoptMesh(const VertexRange& vertices_, uint32_t vertexCount, uint32_t indexCount, GpuBufferPool* pool_, ChunkRenderer* renderer_) {
+  release();
+
+  vertices = vertices_;
+  pool = pool_;
+  renderer = renderer_;
+  slot = renderer->addChunk(chunkPos, voxelScale, vertices, vertexCount, indexCount);
 }
@@ -4,6 +4,9 @@
 #include <glad/glad.h>
 #include <vector>
 #include "config.h"
+#include "gpu_buffer_pool.h"
+
+class ChunkRenderer;
 
 class Chunk {
 public:
@@ -12,24 +15,33 @@ public:
   static constexpr int CHUNK_HEIGHT = Config::CHUNK_HEIGHT;
   static constexpr int CHUNK_DEPTH = Config::CHUNK_DEPTH;
 
-  Chunk(glm::vec3 chunkPosition);
+  // voxelScale: world units per voxel (see lod_scale)
+  Chunk(glm::vec3 chunkPosition, float voxelScale = 1.0f);
 
   ~Chunk();
 
-  // prevent accidental copy/move
+  // owns its vertex range and render slot: no copies, moves hand them over
   Chunk(const Chunk&) = delete;
   Chunk& operator=(const Chunk&) = delete;
-  Chunk(Chunk&&) = delete;
-  Chunk& operator=(Chunk&&) = delete;
+  Chunk(Chunk&& other) noexcept;
+  Chunk& operator=(Chunk&& other) noexcept;
+
+  // registers the mesh (vertexCount vertices, then indexCount indices) with
+  // renderer; on release the range goes back to pool
+  void adoptMesh(const VertexRange& vertices, uint32_t vertexCount, uint32_t indexCount, GpuBufferPool* pool, ChunkRenderer* renderer);
 
-  void renderRaw();
+  // unregisters the mesh and returns its range to the pool, if there is one
+  void release();
 
-  void adoptPrebuilt(GLuint vao, GLuint vertexSSBO, GLuint indirectBuffer);
+  bool hasMesh() const { return renderer != nullptr; }
+  uint32_t renderSlot() const { return slot; }
 
   glm::vec3 chunkPos;
+  float voxelScale;
 
 private:
-  unsigned int VAO; // vertex array object
-  unsigned int vertexSSBO; // vertex output buffer
-  unsigned int indirectBuffer;
+  VertexRange vertices; // packed vertices inside a pool slab
+  GpuBufferPool* pool;
+  ChunkRenderer* renderer;
+  uint32_t slot; // in renderer's chunk-info buffer
 };
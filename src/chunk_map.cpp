@@ -0,0 +1,99 @@
+#include "chunk_map.h"
+
+#include <utility>
+
+namespace {
+    constexpr size_t MIN_SLOTS = 16;
+}
+
+ChunkMap::ChunkMap(size_t expected) {
+    rehash(MIN_SLOTS);
+    reserve(expected);
+}
+
+size_t ChunkMap::probe(long long key) const {
+    size_t i = home(key);
+    while (slots[i].index != NO_ENTRY && slots[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+ChunkMap::Entry* ChunkMap::find(long long key) {
+    const Slot& s = slots[probe(key)];
+    return s.index == NO_ENTRY ? nullptr : &entries[s.index];
+}
+
+ChunkMap::Entry& ChunkMap::insert(const ChunkKey& coord, const glm::vec3& worldPos) {
+    if ((entries.size() + 1) * 2 > slots.size()) {
+        rehash(slots.size() * 2);
+    }
+
+    long long key = key64(coord);
+    size_t i = probe(key);
+    if (slots[i].index != NO_ENTRY) {
+        return entries[slots[i].index];
+    }
+
+    entries.push_back(Entry{ coord, State::Requested, Chunk(worldPos, lod_scale(coord.lod)) });
+    slots[i] = Slot{ key, uint32_t(entries.size() - 1) };
+    return entries.back();
+}
+
+bool ChunkMap::erase(long long key) {
+    size_t hole = probe(key);
+    if (slots[hole].index == NO_ENTRY) {
+        return false;
+    }
+
+    // keep entries dense: the last one moves into the erased position
+    uint32_t index = slots[hole].index;
+    uint32_t last = uint32_t(entries.size() - 1);
+    if (index != last) {
+        entries[index] = std::move(entries[last]);
+        slots[probe(key64(entries[index].coord))].index = index;
+    }
+    entries.pop_back();
+
+    // backward-shift: pull later members of the probe run into the hole unless
+    // that would move them in front of their home slot
+    size_t j = hole;
+    while (true) {
+        j = (j + 1) & mask;
+        if (slots[j].index == NO_ENTRY) {
+            break;
+        }
+        size_t h = home(slots[j].key);
+        if (((j - h) & mask) >= ((j - hole) & mask)) {
+            slots[hole] = slots[j];
+            hole = j;
+        }
+    }
+    slots[hole].index = NO_ENTRY;
+    return true;
+}
+
+void ChunkMap::reserve(size_t n) {
+    size_t want = MIN_SLOTS;
+    while (want < n * 2) {
+        want <<= 1;
+    }
+    if (want > slots.size()) {
+        rehash(want);
+    }
+    entries.reserve(n);
+}
+
+void ChunkMap::rehash(size_t slotCount) {
+    slots.assign(slotCount, Slot{ 0, NO_ENTRY });
+    mask = slotCount - 1;
+    shift = 64;
+    for (size_t n = slotCount; n > 1; n >>= 1) {
+        shift--;
+    }
+
+    for (uint32_t i = 0; i < uint32_t(entries.size()); ++i) {
+        long long key = key64(entries[i].coord);
+        slots[probe(key)] = Slot{ key, i };
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chunk.h"
+#include "worker_types.h"
+
+// every chunk the world tracks, whether loaded or still being generated, in one
+// flat table. entries live densely in a vector (iteration touches only live
+// chunks); an open-addressing index over key64 maps coordinates to entries.
+// the index uses linear probing with fibonacci hashing and stays at most half
+// full; erase swaps the last entry into the hole and shifts the probe run back,
+// so there are no tombstones.
+class ChunkMap {
+public:
+    enum class State : uint8_t {
+        Requested, // job queued or in flight
+        Empty,     // generated, no geometry
+        Loaded,    // generated, mesh adopted by chunk
+    };
+
+    struct Entry {
+        ChunkKey coord;
+        State state;
+        Chunk chunk;
+        uint8_t seams = 0;       // seam mask of the latest job (see GenJob::seams)
+        bool remeshing = false;  // Empty/Loaded with a job for a new seam mask pending
+    };
+
+    explicit ChunkMap(size_t expected = 0);
+
+    // nullptr when absent. pointers are invalidated by insert/erase
+    Entry* find(long long key);
+    Entry* find(const ChunkKey& coord) { return find(key64(coord)); }
+
+    // adds coord in the Requested state; returns the existing entry if present
+    Entry& insert(const ChunkKey& coord, const glm::vec3& worldPos);
+
+    bool erase(long long key);
+    bool erase(const ChunkKey& coord) { return erase(key64(coord)); }
+
+    // grows the index so n entries fit without rehashing
+    void reserve(size_t n);
+
+    size_t size() const { return entries.size(); }
+
+    std::vector<Entry>::iterator begin() { return entries.begin(); }
+    std::vector<Entry>::iterator end() { return entries.end(); }
+
+private:
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    struct Slot {
+        long long key;
+        uint32_t index; // into entries, NO_ENTRY when free
+    };
+
+    size_t home(long long key) const {
+        return size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+    // slot holding key, or the free slot that ends its probe run
+    size_t probe(long long key) const;
+    void rehash(size_t slotCount);
+
+    std::vector<Entry> entries;
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    unsigned shift = 64;
+};
@@ -0,0 +1,273 @@
+#include "chunk_renderer.h"
+
+#include <cstddef>
+#include "config.h"
+
+namespace {
+    constexpr uint32_t INITIAL_SLOTS = 1024;
+
+    // layout of the CullStats block in cull.comp
+    struct GpuCullStats {
+        GLuint chunksTested;
+        GLuint frustumCulled;
+        GLuint occlusionCulled;
+        GLuint chunksDrawn;
+        GLuint indicesDrawn;
+        GLuint indicesCulled;
+    };
+}
+
+ChunkRenderer::ChunkRenderer(GLuint cullProgram) : cullProg(cullProgram) {
+    glGenBuffers(1, &infoBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &drawCountBuffer);
+    glGenBuffers(GLsizei(STATS_FRAMES), statsBuffers);
+    for (GLuint buffer : statsBuffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuCullStats), nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    indirectCount = GLAD_GL_ARB_indirect_parameters != 0;
+    growInfo(INITIAL_SLOTS);
+
+    // one vao for everything: binding 0 is the slab being drawn, binding 1 the
+    // chunk-info buffer stepped once per instance (i.e. by baseInstance)
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    // location 0: aPos, location 1: aNormal (packed uvec2 per vertex)
+    glEnableVertexAttribArray(0);
+    glVertexAttribIFormat(0, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(0, 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIFormat(1, 1, GL_UNSIGNED_INT, sizeof(GLuint));
+    glVertexAttribBinding(1, 0);
+
+    // location 2: aChunkOrigin (xyz corner, w voxel scale)
+    glEnableVertexAttribArray(2);
+    glVertexAttribFormat(2, 4, GL_FLOAT, GL_FALSE, offsetof(ChunkInfo, origin));
+    glVertexAttribBinding(2, 1);
+    glVertexBindingDivisor(1, 1);
+
+    glBindVertexArray(0);
+}
+
+ChunkRenderer::~ChunkRenderer() {
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &infoBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &drawCountBuffer);
+    glDeleteBuffers(GLsizei(STATS_FRAMES), statsBuffers);
+    for (GLsync fence : statsFences) {
+        if (fence) glDeleteSync(fence);
+    }
+}
+
+void ChunkRenderer::growInfo(uint32_t slots) {
+    uint32_t old = uint32_t(info.size());
+    info.resize(slots, ChunkInfo{});
+    for (uint32_t s = slots; s > old; --s) {
+        freeSlots.push_back(s - 1);
+    }
+
+    // the whole mirror is re-uploaded; growth is rare
+    glBindBuffer(GL_ARRAY_BUFFER, infoBuffer);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(info.size() * sizeof(ChunkInfo)), info.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+uint32_t ChunkRenderer::addChunk(const glm::vec3& origin, float voxelScale, const VertexRange& vertices, uint32_t vertexCount, uint32_t indexCount) {
+    if (freeSlots.empty()) {
+        growInfo(uint32_t(info.size()) * 2);
+    }
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    uint32_t firstIndex = 2 * (vertices.first + vertexCount);
+    info[slot] = ChunkInfo{ glm::vec4(origin, voxelScale), vertices.first, indexCount, vertices.slab, firstIndex };
+    glBindBuffer(GL_ARRAY_BUFFER, infoBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(slot * sizeof(ChunkInfo)), sizeof(ChunkInfo), &info[slot]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (vertices.slab >= batches.size()) {
+        batches.resize(vertices.slab + 1);
+    }
+    batches[vertices.slab].buffer = vertices.buffer;
+    return slot;
+}
+
+void ChunkRenderer::removeChunk(uint32_t slot) {
+    // a zero count is what the cull pass skips
+    info[slot].count = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, infoBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(slot * sizeof(ChunkInfo) + offsetof(ChunkInfo, count)), sizeof(uint32_t), &info[slot].count);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    freeSlots.push_back(slot);
+}
+
+void ChunkRenderer::begin() {
+    for (auto& batch : batches) {
+        batch.commands.clear();
+    }
+}
+
+void ChunkRenderer::add(uint32_t slot) {
+    const ChunkInfo& ci = info[slot];
+    batches[ci.slab].commands.push_back(DrawCommand{ ci.count, 1u, ci.firstIndex, GLint(ci.first), slot });
+}
+
+void ChunkRenderer::submit() {
+    // all batches go into one command buffer, back to back
+    upload.clear();
+    for (const auto& batch : batches) {
+        upload.insert(upload.end(), batch.commands.begin(), batch.commands.end());
+    }
+    drawCalls = 0;
+    stats = CullStats{};
+    stats.chunksTested = uint32_t(info.size() - freeSlots.size());
+    stats.chunksDrawn = uint32_t(upload.size());
+    stats.frustumCulled = stats.chunksTested - stats.chunksDrawn;
+    uint64_t indicesDrawn = 0;
+    uint64_t indicesTotal = 0;
+    for (const auto& cmd : upload) {
+        indicesDrawn += cmd.count;
+    }
+    for (const auto& ci : info) {
+        indicesTotal += ci.count;
+    }
+    stats.trianglesDrawn = indicesDrawn / 3;
+    stats.trianglesCulled = (indicesTotal - indicesDrawn) / 3;
+    if (upload.empty()) return;
+
+    // orphan and refill; the driver hands out fresh storage while last frame's draws finish
+    GLsizeiptr bytes = GLsizeiptr(upload.size() * sizeof(DrawCommand));
+    reserveCommands(bytes);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, upload.data());
+
+    glBindVertexArray(vao);
+    glBindVertexBuffer(1, infoBuffer, 0, sizeof(ChunkInfo));
+    size_t offset = 0;
+    for (const auto& batch : batches) {
+        if (batch.commands.empty()) continue;
+        glBindVertexBuffer(0, batch.buffer, 0, 2 * sizeof(GLuint));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.buffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(offset * sizeof(DrawCommand)), GLsizei(batch.commands.size()), 0);
+        offset += batch.commands.size();
+        drawCalls++;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void ChunkRenderer::reserveCommands(GLsizeiptr bytes) {
+    if (bytes > commandCapacity) {
+        commandCapacity = bytes * 2;
+    }
+}
+
+void ChunkRenderer::readStats(uint32_t frame) {
+    GLsync& fence = statsFences[frame];
+    if (!fence) return;
+
+    // STATS_FRAMES old by now; if it still hasn't signalled, skip the sample
+    // rather than wait
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+        GpuCullStats gs{};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[frame]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(gs), &gs);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        stats.chunksTested = gs.chunksTested;
+        stats.frustumCulled = gs.frustumCulled;
+        stats.occlusionCulled = gs.occlusionCulled;
+        stats.chunksDrawn = gs.chunksDrawn;
+        stats.trianglesDrawn = gs.indicesDrawn / 3;
+        stats.trianglesCulled = gs.indicesCulled / 3;
+    }
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+void ChunkRenderer::drawCulled(const Frustum& frustum, const HiZPyramid* occluders) {
+    const uint32_t slotCount = uint32_t(info.size());
+    const uint32_t slabCount = uint32_t(batches.size());
+    drawCalls = 0;
+    if (slabCount == 0) return;
+
+    const uint32_t frame = statsFrame++ % STATS_FRAMES;
+    readStats(frame);
+
+    // every slab gets a region large enough for all slots
+    GLsizeiptr bytes = GLsizeiptr(slabCount) * slotCount * sizeof(DrawCommand);
+    reserveCommands(bytes);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity, nullptr, GL_STREAM_DRAW);
+    glClearBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, 0, bytes, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(slabCount * sizeof(GLuint)), nullptr, GL_STREAM_DRAW);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers[frame]);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    GLint drawProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &drawProgram);
+
+    glUseProgram(cullProg);
+    glUniform4fv(glGetUniformLocation(cullProg, "frustumPlanes"), 6, &frustum.planes[0][0]);
+    glUniform3f(glGetUniformLocation(cullProg, "chunkSize"), float(Config::CHUNK_WIDTH), float(Config::CHUNK_HEIGHT), float(Config::CHUNK_DEPTH));
+    glUniform1ui(glGetUniformLocation(cullProg, "slotCount"), slotCount);
+    glUniform1ui(glGetUniformLocation(cullProg, "regionSize"), slotCount);
+    glUniform1i(glGetUniformLocation(cullProg, "compact"), indirectCount ? 1 : 0);
+
+    bool occlusion = occluders && occluders->valid();
+    glUniform1i(glGetUniformLocation(cullProg, "occlusion"), occlusion ? 1 : 0);
+    if (occlusion) {
+        GLint activeUnit = 0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+        glActiveTexture(GL_TEXTURE0 + HiZPyramid::TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, occluders->texture());
+        glActiveTexture(GLenum(activeUnit));
+        glUniform1i(glGetUniformLocation(cullProg, "hiz"), GLint(HiZPyramid::TEXTURE_UNIT));
+        glUniformMatrix4fv(glGetUniformLocation(cullProg, "hizViewProj"), 1, GL_FALSE, &occluders->viewProj()[0][0]);
+        glUniform1i(glGetUniformLocation(cullProg, "hizLevels"), occluders->levelCount());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, infoBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawCountBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, statsBuffers[frame]);
+    glDispatchCompute((slotCount + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    statsFences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    glUseProgram(GLuint(drawProgram));
+
+    glBindVertexArray(vao);
+    glBindVertexBuffer(1, infoBuffer, 0, sizeof(ChunkInfo));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    if (indirectCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, drawCountBuffer);
+    }
+    for (uint32_t s = 0; s < slabCount; ++s) {
+        if (!batches[s].buffer) continue;
+        glBindVertexBuffer(0, batches[s].buffer, 0, 2 * sizeof(GLuint));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batches[s].buffer);
+        const void* region = (const void*)(size_t(s) * slotCount * sizeof(DrawCommand));
+        if (indirectCount) {
+            glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, region, GLintptr(s * sizeof(GLuint)), GLsizei(slotCount), 0);
+        } else {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, region, GLsizei(slotCount), 0);
+        }
+        drawCalls++;
+    }
+    if (indirectCount) {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
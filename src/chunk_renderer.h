@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "frustum.h"
+#include "gpu_buffer_pool.h"
+#include "hiz_pyramid.h"
+
+// draws every visible chunk with one glMultiDrawElementsIndirect per vertex slab
+// (normally a single slab). each loaded chunk owns a slot in a chunk-info
+// buffer; the draw command's baseInstance is that slot, and the buffer doubles
+// as an instanced vertex attribute so the vertex shader gets the chunk origin
+// without a per-draw uniform. a slab holds each chunk's vertices followed by
+// its 32-bit indices and is bound as both vertex and element buffer. visibility is decided either on the cpu
+// (begin/add/submit) or entirely on the gpu by drawCulled(), which can also
+// drop chunks hidden behind last frame's depth.
+class ChunkRenderer {
+public:
+    // std430 / vertex layout of one slot
+    struct ChunkInfo {
+        glm::vec4 origin;    // xyz world position of the chunk corner, w voxel scale
+        uint32_t first;      // first vertex in the slab, the draw's baseVertex
+        uint32_t count;      // indices
+        uint32_t slab;
+        uint32_t firstIndex; // in uint32s from the start of the slab
+    };
+
+    // what the last culled frame did with the loaded chunks. from the gpu path
+    // these arrive a few frames late, read back without stalling
+    struct CullStats {
+        uint32_t chunksTested = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t occlusionCulled = 0;
+        uint32_t chunksDrawn = 0;
+        uint64_t trianglesDrawn = 0;
+        uint64_t trianglesCulled = 0;
+    };
+
+    // cullProgram: shaders/cull.comp
+    explicit ChunkRenderer(GLuint cullProgram);
+    ~ChunkRenderer();
+
+    ChunkRenderer(const ChunkRenderer&) = delete;
+    ChunkRenderer& operator=(const ChunkRenderer&) = delete;
+
+    // vertices holds vertexCount vertices, then indexCount indices (see mesh_slots)
+    uint32_t addChunk(const glm::vec3& origin, float voxelScale, const VertexRange& vertices, uint32_t vertexCount, uint32_t indexCount);
+    void removeChunk(uint32_t slot);
+
+    // per frame: queue the visible slots, then submit
+    void begin();
+    void add(uint32_t slot);
+    void submit();
+
+    // frustum-tests every slot in a compute pass that writes the draw commands,
+    // then draws them; no per-chunk cpu work. with occluders, chunks behind
+    // their depth are dropped too. restores the current program
+    void drawCulled(const Frustum& frustum, const HiZPyramid* occluders = nullptr);
+
+    uint32_t lastDrawCalls() const { return drawCalls; }
+    const CullStats& lastCullStats() const { return stats; }
+
+private:
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+    struct SlabBatch {
+        GLuint buffer = 0;
+        std::vector<DrawCommand> commands;
+    };
+
+    void growInfo(uint32_t slots);
+    void reserveCommands(GLsizeiptr bytes);
+    void readStats(uint32_t frame);
+
+    static constexpr uint32_t STATS_FRAMES = 3; // readback latency in frames
+
+    GLuint vao = 0;
+    GLuint infoBuffer = 0;    // ChunkInfo per slot
+    GLuint commandBuffer = 0; // rewritten every frame
+    GLsizeiptr commandCapacity = 0;
+    GLuint drawCountBuffer = 0; // per-slab draw counts written by the cull pass
+    GLuint cullProg = 0;
+    bool indirectCount = false; // GL_ARB_indirect_parameters available
+    GLuint statsBuffers[STATS_FRAMES] = {};
+    GLsync statsFences[STATS_FRAMES] = {};
+    uint32_t statsFrame = 0;
+
+    std::vector<ChunkInfo> info; // cpu mirror of infoBuffer
+    std::vector<uint32_t> freeSlots;
+    std::vector<SlabBatch> batches; // indexed by slab
+    std::vector<DrawCommand> upload;
+
+    uint32_t drawCalls = 0;
+    CullStats stats;
+};
@@ -0,0 +1,177 @@
+#include "chunk_scheduler.h"
+#include "cpu_backend.h"
+#include "job_queues.h"
+#include "gen_job_queue.h"
+#include "worker_types.h"
+
+namespace {
+    // chunks are cut into SLABS z-ranges of SLAB_DEPTH voxels
+    constexpr int SLABS = 4;
+    constexpr int SLAB_DEPTH = Config::CHUNK_DEPTH / SLABS;
+    static_assert(Config::CHUNK_DEPTH % SLABS == 0, "chunk depth must split evenly into slabs");
+
+    // density points of a slab; the last one also owns the shared far face
+    inline int density_z_end(int slab) {
+        return slab == SLABS - 1 ? CpuMesher::POINTS_Z : (slab + 1) * SLAB_DEPTH;
+    }
+}
+
+struct ChunkScheduler::ChunkTask {
+    GenJob job;
+    GenResult res;
+    std::vector<float> densities = std::vector<float>(CpuMesher::NUM_POINTS);
+    std::vector<CpuMesher::Counts> offsets = std::vector<CpuMesher::Counts>(CpuMesher::NUM_POINTS);
+    CpuMesher::Counts slabTotals[SLABS] = {};
+    CpuMesher::Counts slabBase[SLABS] = {};
+    std::atomic<int> remaining{0};
+};
+
+ChunkScheduler::ChunkScheduler(GenJobQueue* in,
+            SPSCQueue<GenResult>* out,
+            unsigned workers,
+            int terrainMode)
+        : inQ(in),
+          outQ(out),
+          pool(workers),
+          terrainMode(terrainMode),
+          inFlight(std::ptrdiff_t(pool.workerCount()) * 2) {}
+
+ChunkScheduler::~ChunkScheduler() {
+    shutdown();
+}
+
+void ChunkScheduler::start() {
+    feeder = std::thread([this]{ feed(); });
+}
+
+void ChunkScheduler::shutdown() {
+    stop = true;
+    if (inQ) {
+        inQ->close();
+    }
+    if (feeder.joinable()) {
+        feeder.join();
+    }
+    // lets chunks already in the pool finish
+    pool.shutdown();
+}
+
+ChunkScheduler::Stats ChunkScheduler::stats() const {
+    Stats s;
+    s.chunksDone = chunksDone.load();
+    s.emptyChunks = emptyChunks.load();
+    s.vertices = vertices.load();
+    s.workers = pool.stats();
+    return s;
+}
+
+void ChunkScheduler::feed() {
+    while (!stop) {
+        // wait for a free slot before taking a job so it leaves the priority
+        // queue as late as possible
+        inFlight.acquire();
+        auto jobOpt = inQ->pop();
+        if (!jobOpt.has_value() || stop) {
+            inFlight.release();
+            break;
+        }
+
+        ChunkTask* task = acquireTask();
+        task->job = *jobOpt;
+        task->res = GenResult{};
+        task->res.key = task->job.key;
+        task->res.worldPos = task->job.worldPos;
+        task->res.seams = task->job.seams;
+        task->remaining.store(SLABS, std::memory_order_relaxed);
+
+        for (int s = 0; s < SLABS; ++s) {
+            pool.submit([this, task, s]{ runDensity(task, s); });
+        }
+    }
+}
+
+// first wave: density
+void ChunkScheduler::runDensity(ChunkTask* task, int slab) {
+    CpuMesher::fill_density(task->job.worldPos, lod_scale(task->job.key.lod), terrainMode, task->densities.data(), slab * SLAB_DEPTH, density_z_end(slab));
+
+    if (task->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    // seam faces span every slab, so they are stitched once the whole chunk is filled
+    CpuMesher::stitch_density(task->densities.data(), task->job.seams);
+    task->remaining.store(SLABS, std::memory_order_relaxed);
+    for (int s = 0; s < SLABS; ++s) {
+        pool.submit([this, task, s]{ runCount(task, s); });
+    }
+}
+
+// second wave: count, then the last slab turns slab totals into bases
+void ChunkScheduler::runCount(ChunkTask* task, int slab) {
+    task->slabTotals[slab] = CpuMesher::count(task->densities.data(), task->offsets.data(), slab * SLAB_DEPTH, density_z_end(slab));
+
+    if (task->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    CpuMesher::Counts total;
+    for (int s = 0; s < SLABS; ++s) {
+        task->slabBase[s] = total;
+        total.vertices += task->slabTotals[s].vertices;
+        total.indices += task->slabTotals[s].indices;
+    }
+    task->res.totalVertices = total.vertices;
+    task->res.totalIndices = total.indices;
+    if (total.indices == 0) {
+        finish(task);
+        return;
+    }
+
+    task->res.cpuVertices.resize(total.vertices);
+    task->res.cpuIndices.resize(total.indices);
+    task->remaining.store(SLABS, std::memory_order_relaxed);
+    for (int s = 0; s < SLABS; ++s) {
+        pool.submit([this, task, s]{ runEmit(task, s); });
+    }
+}
+
+// third wave: emit into the slab's ranges of the vertex and index streams.
+// triangles in a slab's last voxel layer also use vertices of the next slab
+void ChunkScheduler::runEmit(ChunkTask* task, int slab) {
+    const CpuMesher::Counts& slabTotal = task->slabTotals[slab];
+    if (slabTotal.vertices != 0 || slabTotal.indices != 0) {
+        uint32_t nextVertexBase = slab + 1 < SLABS ? task->slabBase[slab + 1].vertices : 0;
+        CpuMesher::emit(task->densities.data(), task->offsets.data(), task->slabBase[slab], nextVertexBase,
+                        task->res.cpuVertices.data(), task->res.cpuIndices.data(),
+                        slab * SLAB_DEPTH, density_z_end(slab), CpuMesher::seams_of(task->job));
+    }
+
+    if (task->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    finish(task);
+}
+
+void ChunkScheduler::finish(ChunkTask* task) {
+    chunksDone.fetch_add(1, std::memory_order_relaxed);
+    vertices.fetch_add(task->res.totalVertices, std::memory_order_relaxed);
+    if (task->res.totalIndices == 0) {
+        emptyChunks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(outM);
+        outQ->push(std::move(task->res));
+    }
+    releaseTask(task);
+    inFlight.release();
+}
+
+ChunkScheduler::ChunkTask* ChunkScheduler::acquireTask() {
+    std::lock_guard<std::mutex> lk(freeM);
+    if (freeTasks.empty()) {
+        allTasks.push_back(std::make_unique<ChunkTask>());
+        return allTasks.back().get();
+    }
+    ChunkTask* task = freeTasks.back();
+    freeTasks.pop_back();
+    return task;
+}
+
+void ChunkScheduler::releaseTask(ChunkTask* task) {
+    std::lock_guard<std::mutex> lk(freeM);
+    freeTasks.push_back(task);
+}
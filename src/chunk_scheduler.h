@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "thread_pool.h"
+
+template<typename T> class SPSCQueue;
+class GenJobQueue;
+struct GenJob;
+struct GenResult;
+
+// cpu generation on a work-stealing pool. each chunk is split into z-slabs and
+// runs as three dependent waves of slab tasks (density, count, emit), so many
+// chunks and the stages within a chunk are in flight across all workers.
+class ChunkScheduler {
+public:
+  struct Stats {
+    uint64_t chunksDone = 0;
+    uint64_t emptyChunks = 0;
+    uint64_t vertices = 0;
+    std::vector<WorkStealingPool::WorkerStats> workers;
+  };
+
+  // workers == 0 uses every hardware thread
+  ChunkScheduler(GenJobQueue* in,
+                 SPSCQueue<GenResult>* out,
+                 unsigned workers = Config::GEN_WORKER_THREADS,
+                 int terrainMode = Config::TERRAIN_MODE);
+  ~ChunkScheduler();
+
+  void start();
+  void shutdown();
+
+  unsigned workerCount() const { return pool.workerCount(); }
+  Stats stats() const;
+
+private:
+  struct ChunkTask;
+
+  void feed();
+  void runDensity(ChunkTask* task, int slab);
+  void runCount(ChunkTask* task, int slab);
+  void runEmit(ChunkTask* task, int slab);
+  void finish(ChunkTask* task);
+
+  ChunkTask* acquireTask();
+  void releaseTask(ChunkTask* task);
+
+  GenJobQueue* inQ = nullptr;
+  SPSCQueue<GenResult>* outQ = nullptr;
+  WorkStealingPool pool;
+  std::thread feeder;
+  std::atomic<bool> stop{false};
+  const int terrainMode;
+
+  // bounds chunks in flight (and so scratch memory) to a few per worker
+  std::counting_semaphore<> inFlight;
+
+  // recycled per-chunk scratch
+  std::mutex freeM;
+  std::vector<std::unique_ptr<ChunkTask>> allTasks;
+  std::vector<ChunkTask*> freeTasks;
+
+  // results come from any worker; the lock keeps outQ single-producer
+  std::mutex outM;
+
+  std::atomic<uint64_t> chunksDone{0};
+  std::atomic<uint64_t> emptyChunks{0};
+  std::atomic<uint64_t> vertices{0};
+};
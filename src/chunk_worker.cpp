@@ -2,27 +2,75 @@
 #include "chunk.h"
 #include "config.h"
 #include "job_queues.h"
+#include "gen_job_queue.h"
+#include "gpu_buffer_pool.h"
 #include "worker_types.h"
 #include "marching_cubes.h"
+#include <algorithm>
+#include <deque>
 #include <iostream>
 
+namespace {
+    // count and emit run one invocation per density point, in 8^3 groups
+    constexpr GLuint POINT_GROUPS_X = (Chunk::CHUNK_WIDTH + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Y = (Chunk::CHUNK_HEIGHT + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Z = (Chunk::CHUNK_DEPTH + 1 + 7) / 8;
+    // the heightfield passes run one invocation per point column, in 8^2
+    // groups, times the chunks of the batch
+    constexpr GLuint COLUMN_GROUPS_X = (Chunk::CHUNK_WIDTH + 1 + 7) / 8;
+    constexpr GLuint COLUMN_GROUPS_Z = (Chunk::CHUNK_DEPTH + 1 + 7) / 8;
+    constexpr GLuint COLUMN_POINTS = (Chunk::CHUNK_WIDTH + 1) * (Chunk::CHUNK_DEPTH + 1);
+
+    static_assert(Config::GPU_BATCH_SIZE >= 1 && Config::GPU_BATCH_SIZE <= Config::GPU_HEIGHT_CACHE_COLUMNS,
+                  "a batch's columns must fit the height cache between flushes");
+
+    // uniforms of terrain.comp
+    void set_terrain_uniforms(GLuint prog, const glm::vec3& worldPos, float voxelScale, int terrainMode, uint32_t heightBase) {
+        glUniform3fv(glGetUniformLocation(prog, "chunkWorldPos"), 1, &worldPos[0]);
+        glUniform1i(glGetUniformLocation(prog, "terrainMode"), terrainMode);
+        glUniform1f(glGetUniformLocation(prog, "voxelScale"), voxelScale);
+        glUniform1ui(glGetUniformLocation(prog, "heightBase"), heightBase);
+    }
+
+    GLuint make_ssbo(GLsizeiptr bytes) {
+        GLuint b = 0;
+        glGenBuffers(1, &b);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+        return b;
+    }
+}
 
 ChunkWorker::ChunkWorker(GLFWwindow* worker,
-            BlockingQueue<GenJob>* in,
+            GenJobQueue* in,
             SPSCQueue<GenResult>* out,
+            GpuBufferPool* pool,
             GLuint density,
             GLuint mcCount,
             GLuint mcEmit,
+            GLuint mcStitch,
+            GLuint heights,
+            GLuint mcHeightCount,
+            GLuint mcHeightEmit,
             GLuint triTableSSBO,
             GLuint edgeTableSSBO)
         : worker_window(worker),
           inQ(in),
           outQ(out),
+          buffers(pool),
           densityProg(density),
           mcCountProg(mcCount),
           mcEmitProg(mcEmit),
+          mcStitchProg(mcStitch),
+          mcHeightCountProg(mcHeightCount),
+          mcHeightEmitProg(mcHeightEmit),
           triSSBO(triTableSSBO),
-          edgeSSBO(edgeTableSSBO) {}
+          edgeSSBO(edgeTableSSBO),
+          heightCache(heights) {}
+
+void ChunkWorker::setBatchSize(uint32_t chunks) {
+    batchSize = std::clamp<uint32_t>(chunks, 1, Config::GPU_HEIGHT_CACHE_COLUMNS);
+}
 
 void ChunkWorker::start() {
     th = std::thread([this]{ run(); });
@@ -42,40 +90,110 @@ void ChunkWorker::shutdown() {
 void ChunkWorker::run() {
     glfwMakeContextCurrent(worker_window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    prof = profiler ? profiler->thread("chunk worker") : nullptr;
+
+    // fused density: the densities live only from the count pass to the emit
+    // right after it, so one buffer serves every job (each emit ends with a
+    // barrier before the next count overwrites it)
+    if (Config::GPU_FUSED_DENSITY) {
+        sparseDensitySSBO = buffers->acquire(GpuBufferPool::Kind::Density);
+        groupStateSSBO = buffers->acquire(GpuBufferPool::Kind::Groups);
+    }
 
+    // seam-free heightmap chunks skip marching cubes over the point grid and
+    // go through the heightfield passes, a batch of them per dispatch
+    const bool batching = Config::GPU_HEIGHTFIELD_MESHER && terrainMode == 1;
+    if (batching) {
+        batchSSBO = make_ssbo(GLsizeiptr(batchSize) * sizeof(BatchChunk));
+        batchCountersSSBO = make_ssbo(GLsizeiptr(batchSize) * 2 * sizeof(GLuint));
+        batchOffsetsSSBO = make_ssbo(GLsizeiptr(batchSize) * COLUMN_POINTS * 2 * sizeof(GLuint));
+    }
+
+    std::vector<GenJob> jobs(batching ? batchSize : 1);
+    std::vector<GenJob> batch;
     while(!stop){
-        auto jobOpt = inQ->pop();
-        if (!jobOpt.has_value()) break;
-        GenJob job = *jobOpt;
+        size_t n = inQ->popBatch(jobs.data(), jobs.size());
+        if (n == 0) break;
+
+        batch.clear();
+        for (size_t i = 0; i < n; ++i) {
+            if (batching && jobs[i].seams == 0) {
+                batch.push_back(jobs[i]);
+            } else {
+                runJob(jobs[i]);
+            }
+        }
+        if (!batch.empty()) {
+            runBatch(batch);
+        }
+        if (prof) prof->collectGpu();
+    }
+
+    for (const InFlight& f : inFlight) {
+        glDeleteSync(f.fence);
+    }
+    inFlight.clear();
+    glFinish();
+    if (prof) {
+        prof->collectGpu(true);
+        prof->destroy();
+    }
+    buffers->release(GpuBufferPool::Kind::Density, sparseDensitySSBO);
+    buffers->release(GpuBufferPool::Kind::Groups, groupStateSSBO);
+    heightCache.destroy();
+    GLuint batchBuffers[] = { batchSSBO, batchCountersSSBO, batchOffsetsSSBO };
+    glDeleteBuffers(3, batchBuffers);
+    glfwMakeContextCurrent(nullptr);
+}
 
-        GenResult res{}; res.key = job.key; res.worldPos = job.worldPos;
+// bound how far the gpu queue runs ahead of the results being consumed
+void ChunkWorker::throttle(uint32_t chunks) {
+    inFlight.push_back(InFlight{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), chunks });
+    chunksInFlight += chunks;
+    while (inFlight.size() > 1 && chunksInFlight >= Config::GPU_MAX_IN_FLIGHT) {
+        ProfileZone zone(prof, "ChunkWorker::throttle wait");
+        glClientWaitSync(inFlight.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+        glDeleteSync(inFlight.front().fence);
+        chunksInFlight -= inFlight.front().chunks;
+        inFlight.pop_front();
+    }
+}
 
-        // allocate buffers
-        glGenBuffers(1, &res.densitySSBO);
-        glGenBuffers(1, &res.offsetsSSBO);
-        glGenBuffers(1, &res.counterSSBO);
-        glGenBuffers(1, &res.vertexSSBO);
-        glGenBuffers(1, &res.indirect);
+// one chunk through density -> [stitch] -> count -> emit, or the fused passes
+void ChunkWorker::runJob(const GenJob& job) {
+    ProfileZone zone(prof, "ChunkWorker::runJob");
+    GenResult res{}; res.key = job.key; res.worldPos = job.worldPos; res.seams = job.seams;
 
-        const size_t NUM_POINTS = (Chunk::CHUNK_WIDTH+1)*(Chunk::CHUNK_HEIGHT+1)*(Chunk::CHUNK_DEPTH+1);
-        const size_t NUM_VOXELS = (Chunk::CHUNK_WIDTH)*(Chunk::CHUNK_HEIGHT)*(Chunk::CHUNK_DEPTH);
+    const bool fused = Config::GPU_FUSED_DENSITY && job.seams == 0;
+    const float voxelScale = lod_scale(job.key.lod);
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.densitySSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, NUM_POINTS*sizeof(float), nullptr, GL_STATIC_DRAW);
+    // terrainMode 1: every pass below reads the column's cached heights
+    uint32_t heightBase = 0;
+    if (terrainMode == 1) {
+        heightBase = heightCache.column(job.key, res.worldPos);
+        GpuProfileZone gpuZone(prof, "heights");
+        heightCache.flush();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, heightCache.buffer());
+    }
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.offsetsSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, NUM_VOXELS*sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    // scratch buffers come from the pool; World hands them back once the fence signals
+    if (!fused) {
+        res.densitySSBO = buffers->acquire(GpuBufferPool::Kind::Density);
+    }
+    res.offsetsSSBO = buffers->acquire(GpuBufferPool::Kind::Offsets);
+    res.counterSSBO = buffers->acquire(GpuBufferPool::Kind::Counter);
+    const GLuint density = fused ? sparseDensitySSBO : res.densitySSBO;
 
-        GLuint zero=0;
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_DRAW);
+    GLuint zero[2] = { 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
 
-        // first pass: density
+    // first pass: density (the fused count pass evaluates it itself)
+    if (!fused) {
+        GpuProfileZone gpuZone(prof, "density");
         glUseProgram(densityProg);
-
-        glUniform3fv(glGetUniformLocation(densityProg, "chunkWorldPos"), 1, &res.worldPos[0]);
-        glUniform1i(glGetUniformLocation(densityProg, "terrainMode"), terrainMode);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, res.densitySSBO);
+        set_terrain_uniforms(densityProg, res.worldPos, voxelScale, terrainMode, heightBase);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
 
         if (terrainMode == 0) {
             glDispatchCompute((Chunk::CHUNK_WIDTH+1+7)/8, (Chunk::CHUNK_HEIGHT+1+7)/8, (Chunk::CHUNK_DEPTH+1+7)/8);
@@ -85,54 +203,222 @@ void ChunkWorker::run() {
         }
 
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
-        // second pass: count
+    // faces bordering a coarser lod: match the coarse samples before counting
+    if (job.seams != 0) {
+        GpuProfileZone gpuZone(prof, "mc_stitch");
+        glUseProgram(mcStitchProg);
+        glUniform1ui(glGetUniformLocation(mcStitchProg, "seams"), job.seams);
+        glUniform1f(glGetUniformLocation(mcStitchProg, "isolevel"), Config::ISOLEVEL);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
+        glDispatchCompute((Chunk::CHUNK_WIDTH+1+7)/8, (Chunk::CHUNK_WIDTH+1+7)/8, 6);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // second pass: count
+    {
+        GpuProfileZone gpuZone(prof, fused ? "mc_count fused" : "mc_count");
         glUseProgram(mcCountProg);
         glUniform1f(glGetUniformLocation(mcCountProg, "isolevel"), Config::ISOLEVEL);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, res.densitySSBO);
+        glUniform1i(glGetUniformLocation(mcCountProg, "sparseDensity"), fused);
+        if (fused) {
+            set_terrain_uniforms(mcCountProg, res.worldPos, voxelScale, terrainMode, heightBase);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, groupStateSSBO);
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triSSBO);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, edgeSSBO);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, res.counterSSBO);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, res.offsetsSSBO);
-        glDispatchCompute(Chunk::CHUNK_WIDTH/8, Chunk::CHUNK_HEIGHT/8, Chunk::CHUNK_DEPTH/8);
+        glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
         glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    if (Config::GPU_ASYNC_EMIT) {
+        // emit into a range sized up front; World reads the real count once
+        // the fence has signalled
+        res.vertices = buffers->allocVertices(std::max<uint32_t>(Config::GPU_CHUNK_VERTEX_BUDGET, job.slotHint));
+        res.countOnGpu = true;
+        dispatchEmit(res, density, fused, heightBase);
+
+        res.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        outQ->push(std::move(res));
+        throttle(1);
+        return;
+    }
 
+    GLsync countFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glClientWaitSync(countFence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+    glDeleteSync(countFence);
+
+    GLuint totals[2] = { 0, 0 }; // vertices, indices
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(totals), totals);
+    res.totalVertices = totals[0];
+    res.totalIndices = totals[1];
+
+    if (res.totalIndices == 0) {
+        res.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        outQ->push(std::move(res));
+        return;
+    }
+    res.vertices = buffers->allocVertices(mesh_slots(res.totalVertices, res.totalIndices));
+    dispatchEmit(res, density, fused, heightBase);
+
+    // fence and flush
+    res.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    outQ->push(std::move(res));
+}
+
+// seam-free terrainMode 1 chunks: heights, count and emit each dispatched once
+// for the whole batch, gl_WorkGroupID.z selecting the chunk (chunk_batch.comp)
+void ChunkWorker::runBatch(const std::vector<GenJob>& jobs) {
+    ProfileZone zone(prof, "ChunkWorker::runBatch");
+    const GLuint n = GLuint(jobs.size());
+    std::vector<GenResult> results(n);
+    batchChunks.assign(n, BatchChunk{});
+    for (GLuint i = 0; i < n; ++i) {
+        const GenJob& job = jobs[i];
+        GenResult& res = results[i];
+        res.key = job.key; res.worldPos = job.worldPos; res.seams = job.seams;
+        batchChunks[i].worldPos = glm::vec4(job.worldPos, lod_scale(job.key.lod));
+        batchChunks[i].heightBase = heightCache.column(job.key, job.worldPos);
+    }
+    {
+        GpuProfileZone gpuZone(prof, "heights");
+        heightCache.flush();
+    }
+
+    // the emit's ranges, grouped by slab: one emit dispatch per slab
+    std::vector<GLuint> slabs;
+    auto assignRanges = [&]{
+        for (GLuint i = 0; i < n; ++i) {
+            const VertexRange& r = results[i].vertices;
+            BatchChunk& c = batchChunks[i];
+            c.baseVertex = r.first;
+            c.vertexCapacity = r.count;
+            if (r.count == 0) {
+                c.slab = ~0u; // nothing to emit
+                continue;
+            }
+            auto it = std::find(slabs.begin(), slabs.end(), r.buffer);
+            c.slab = uint32_t(it - slabs.begin());
+            if (it == slabs.end()) {
+                slabs.push_back(r.buffer);
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, batchSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(n * sizeof(BatchChunk)), batchChunks.data());
+    };
+
+    if (Config::GPU_ASYNC_EMIT) {
+        // emit into ranges sized up front, like runJob
+        for (GLuint i = 0; i < n; ++i) {
+            results[i].vertices = buffers->allocVertices(std::max<uint32_t>(Config::GPU_CHUNK_VERTEX_BUDGET, jobs[i].slotHint));
+            results[i].countOnGpu = true;
+        }
+    }
+    assignRanges();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, batchCountersSSBO);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_RG32UI, 0, GLsizeiptr(n) * 2 * sizeof(GLuint),
+                         GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, batchCountersSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, batchOffsetsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, heightCache.buffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, batchSSBO);
+
+    // count
+    {
+        GpuProfileZone gpuZone(prof, "mc_height_count");
+        glUseProgram(mcHeightCountProg);
+        glUniform1f(glGetUniformLocation(mcHeightCountProg, "isolevel"), Config::ISOLEVEL);
+        glDispatchCompute(COLUMN_GROUPS_X, COLUMN_GROUPS_Z, n);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    if (!Config::GPU_ASYNC_EMIT) {
         GLsync countFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
         glClientWaitSync(countFence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
         glDeleteSync(countFence);
 
-        GLuint totalVertices = 0;
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
-        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &totalVertices);
-        res.totalVertices = totalVertices;
+        std::vector<glm::uvec2> totals(n); // vertices, indices
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, batchCountersSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(n * sizeof(glm::uvec2)), totals.data());
+        for (GLuint i = 0; i < n; ++i) {
+            results[i].totalVertices = totals[i].x;
+            results[i].totalIndices = totals[i].y;
+            if (totals[i].y > 0) {
+                results[i].vertices = buffers->allocVertices(mesh_slots(totals[i].x, totals[i].y));
+            }
+        }
+        assignRanges();
+    }
 
-        if (totalVertices == 0) {
-            res.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-            glFlush();
-            outQ->push(std::move(res));
-            continue;
+    // emit (packed uvec2 vertices, then 32-bit indices), once per slab
+    {
+        GpuProfileZone gpuZone(prof, "mc_height_emit");
+        glUseProgram(mcHeightEmitProg);
+        glUniform1f(glGetUniformLocation(mcHeightEmitProg, "isolevel"), Config::ISOLEVEL);
+        for (size_t s = 0; s < slabs.size(); ++s) {
+            glUniform1ui(glGetUniformLocation(mcHeightEmitProg, "slab"), GLuint(s));
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, slabs[s]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, slabs[s]);
+            glDispatchCompute(COLUMN_GROUPS_X, COLUMN_GROUPS_Z, n);
         }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.vertexSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, totalVertices * 2u * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+    }
 
-        // third pass: emit (packed uvec2 vertices)
-        glUseProgram(mcEmitProg);
-        glUniform1f(glGetUniformLocation(mcEmitProg, "isolevel"), Config::ISOLEVEL);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, res.densitySSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, edgeSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, res.vertexSSBO);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, res.offsetsSSBO);
-        glDispatchCompute(Chunk::CHUNK_WIDTH/8, Chunk::CHUNK_HEIGHT/8, Chunk::CHUNK_DEPTH/8);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    if (Config::GPU_ASYNC_EMIT) {
+        // World reads each chunk's totals from its own counter buffer
+        glBindBuffer(GL_COPY_READ_BUFFER, batchCountersSSBO);
+        for (GLuint i = 0; i < n; ++i) {
+            results[i].counterSSBO = buffers->acquire(GpuBufferPool::Kind::Counter);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, results[i].counterSSBO);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(i) * 2 * sizeof(GLuint), 0, 2 * sizeof(GLuint));
+        }
+    }
 
-        // fence and flush
+    for (GenResult& res : results) {
         res.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-        glFlush();
-
+    }
+    glFlush();
+    for (GenResult& res : results) {
         outQ->push(std::move(res));
     }
-
-    glfwMakeContextCurrent(nullptr);
+    if (Config::GPU_ASYNC_EMIT) {
+        throttle(n);
+    }
 }
 
+// third pass: emit (packed uvec2 vertices, then 32-bit indices) into the result's slab range
+void ChunkWorker::dispatchEmit(const GenResult& res, GLuint density, bool sparse, uint32_t heightBase) {
+    GpuProfileZone gpuZone(prof, "mc_emit");
+    glUseProgram(mcEmitProg);
+    glUniform1f(glGetUniformLocation(mcEmitProg, "isolevel"), Config::ISOLEVEL);
+    glUniform1ui(glGetUniformLocation(mcEmitProg, "baseVertex"), res.vertices.first);
+    glUniform1ui(glGetUniformLocation(mcEmitProg, "vertexCapacity"), res.vertices.count);
+    glUniform1ui(glGetUniformLocation(mcEmitProg, "seams"), res.seams);
+    glUniform3i(glGetUniformLocation(mcEmitProg, "seamParity"), res.key.x & 1, res.key.y & 1, res.key.z & 1);
+    glUniform1i(glGetUniformLocation(mcEmitProg, "sparseDensity"), sparse);
+    if (sparse) {
+        set_terrain_uniforms(mcEmitProg, res.worldPos, lod_scale(res.key.lod), terrainMode, heightBase);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, groupStateSSBO);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, density);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, edgeSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, res.vertices.buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, res.counterSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, res.offsetsSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, res.vertices.buffer);
+    glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+}
@@ -1,43 +1,94 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <thread>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "config.h"
+#include "height_cache.h"
+#include "profiler.h"
+#include "worker_types.h"
 
-template<typename T> class BlockingQueue;
 template<typename T> class SPSCQueue;
-struct GenJob;
-struct GenResult;
+class GenJobQueue;
+class GpuBufferPool;
 
 class ChunkWorker {
 public:
   ChunkWorker(GLFWwindow* worker,
-              BlockingQueue<GenJob>* in,
+              GenJobQueue* in,
               SPSCQueue<GenResult>* out,
+              GpuBufferPool* pool,
               GLuint density,
               GLuint mcCount,
               GLuint mcEmit,
+              GLuint mcStitch,
+              GLuint heights,
+              GLuint mcHeightCount,
+              GLuint mcHeightEmit,
               GLuint triTableSSBO,
               GLuint edgeTableSSBO);
 
+  // chunks per batched dispatch (see Config::GPU_BATCH_SIZE); before start()
+  void setBatchSize(uint32_t chunks);
+  // zones of the worker thread and its passes (Config::PROFILER); before start()
+  void setProfiler(Profiler* p) { profiler = p; }
+
   void start();
   void shutdown();
 
+  // valid once shutdown() returned
+  const HeightCache::Stats& heightCacheStats() const { return heightCache.stats(); }
+
 private:
+  struct InFlight {
+    GLsync fence = 0;
+    uint32_t chunks = 0;
+  };
+
   void run();
+  void runJob(const GenJob& job);
+  void runBatch(const std::vector<GenJob>& jobs);
+  void dispatchEmit(const GenResult& res, GLuint density, bool sparse, uint32_t heightBase);
+  void throttle(uint32_t chunks);
 
   GLFWwindow* worker_window = nullptr;
-  BlockingQueue<GenJob>* inQ = nullptr;
+  GenJobQueue* inQ = nullptr;
   SPSCQueue<GenResult>* outQ = nullptr;
+  GpuBufferPool* buffers = nullptr;
   std::thread th;
   std::atomic<bool> stop{false};
+  Profiler* profiler = nullptr;
+  Profiler::Thread* prof = nullptr; // worker thread's, while it runs
 
   GLuint densityProg = 0;
   GLuint mcCountProg = 0;
   GLuint mcEmitProg = 0;
+  GLuint mcStitchProg = 0;
+  GLuint mcHeightCountProg = 0;
+  GLuint mcHeightEmitProg = 0;
   GLuint triSSBO = 0;
   GLuint edgeSSBO = 0;
+  // Config::GPU_FUSED_DENSITY: densities of the surface groups, and every
+  // group's state, shared by all jobs (worker thread only)
+  GLuint sparseDensitySSBO = 0;
+  GLuint groupStateSSBO = 0;
+  // terrainMode 1: column heights, read by every pass that samples the terrain
+  HeightCache heightCache;
+
+  // batched heightfield passes: per-chunk parameters, counters and offsets of
+  // the batch in flight, shared by all batches like the fused density
+  uint32_t batchSize = Config::GPU_BATCH_SIZE;
+  GLuint batchSSBO = 0;
+  GLuint batchCountersSSBO = 0;
+  GLuint batchOffsetsSSBO = 0;
+  std::vector<BatchChunk> batchChunks;
+
+  // async emit: fences of the submitted jobs and batches
+  std::deque<InFlight> inFlight;
+  uint32_t chunksInFlight = 0;
 
-  const int terrainMode = 1;
+  const int terrainMode = Config::TERRAIN_MODE;
 };
@@ -8,10 +8,91 @@ namespace Config {
     constexpr int CHUNK_HEIGHT = 64;
     constexpr int CHUNK_DEPTH = 64;
 
+    // extent of the coarsest lod level, in its chunks around the player
     constexpr int VIEW_DISTANCE = 6;
+    constexpr int VERTICAL_VIEW_DISTANCE = 4;
+    // level-of-detail clipmap: LOD_LEVELS nested boxes around the player, level n
+    // built from chunks whose voxels are 2^n units wide. every level leaves a hole
+    // of LOD_RING_RADIUS chunks (LOD_RING_RADIUS_Y vertically) around the player's
+    // chunk that the next finer level fills. 1 level = plain uniform grid
+    constexpr int LOD_LEVELS = 4;
+    constexpr int LOD_RING_RADIUS = 2;
+    constexpr int LOD_RING_RADIUS_Y = 1;
+    // fine chunks snap their faces bordering a coarser level onto its surface,
+    // closing the cracks between levels (see shaders/mc_stitch.comp)
+    constexpr bool LOD_STITCH_SEAMS = true;
     constexpr float ISOLEVEL = 0.0f;
+    constexpr int TERRAIN_MODE = 1; // 0 = 3d noise, 1 = 2d noise heightmap
 
-    constexpr float RENDER_DISTANCE = 2000.0f;
+    // which pipeline builds chunk meshes
+    enum class GenBackend { GPU, CPU };
+    constexpr GenBackend GEN_BACKEND = GenBackend::GPU;
+    constexpr unsigned GEN_WORKER_THREADS = 0; // cpu backend threads, 0 = all hardware threads
+    // extra generation cost for chunks off the view direction: a chunk straight
+    // behind the player is scheduled as if it were (1 + GEN_VIEW_BIAS) times farther
+    constexpr float GEN_VIEW_BIAS = 1.0f;
+    // mark chunks the terrain's noise bounds prove all air or all rock as empty
+    // without queueing a job (see Terrain::bound_occupancy)
+    constexpr bool GEN_SKIP_BOUNDED = true;
+    // keep finished meshes on disk (see MeshCache): a chunk requested again,
+    // in this run or a later one, is uploaded from its memory-mapped region
+    // file instead of generated. regions hold MESH_CACHE_REGION^3 chunks of a lod
+    constexpr bool MESH_CACHE = true;
+    const char* const MESH_CACHE_DIR = "mesh_cache";
+    constexpr int MESH_CACHE_REGION = 16;
+    constexpr unsigned MESH_CACHE_OPEN_REGIONS = 64; // mapped at once, least recently used closed first
+    // stored density grids (see DensityCodec): samples saturate at ISOLEVEL +-
+    // DENSITY_STORE_RANGE and are quantized to DENSITY_STORE_BITS (8 or 16)
+    constexpr float DENSITY_STORE_RANGE = 4.0f;
+    constexpr int DENSITY_STORE_BITS = 16;
+    // sculpting (see TerrainEdits): brushes are placed EDIT_BRUSH_REACH world
+    // units in front of the camera; strength is density change per second at
+    // the centre (smooth and flatten: blend rate)
+    constexpr float EDIT_BRUSH_RADIUS = 6.0f;
+    constexpr float EDIT_BRUSH_REACH = 24.0f;
+    constexpr float EDIT_BRUSH_STRENGTH = 4.0f;
+    // edited chunks remeshed per count readback; each holds a density and an
+    // offsets buffer (3.3 MiB) on the gpu
+    constexpr unsigned EDIT_REMESH_BATCH = 8;
+    const char* const EDITS_FILE = "edits.bricks";
+    // gpu vertex storage is sub-allocated from slabs of this many packed vertices (32 MiB)
+    constexpr unsigned VERTEX_SLAB_VERTICES = 1u << 22;
+    // gpu backend: emit into a pre-sized range so chunks never wait on a count
+    // readback. chunks that overflow the range are regenerated with the measured size
+    constexpr bool GPU_ASYNC_EMIT = true;
+    constexpr unsigned GPU_CHUNK_VERTEX_BUDGET = 1u << 17; // slab slots (mesh_slots), 1 MiB
+    constexpr unsigned GPU_MAX_IN_FLIGHT = 8; // chunks queued on the gpu before the worker waits (at least one batch)
+    // gpu backend: evaluate the terrain inside the count pass and keep only the
+    // densities of the 8^3 groups with surface in them (no density pass, and no
+    // density buffer per chunk). chunks with lod seams take the separate passes
+    constexpr bool GPU_FUSED_DENSITY = true;
+    // gpu backend, terrainMode 1: the 2d heights of a column of chunks are
+    // computed once and kept for every chunk stacked in it, in an lru cache of
+    // this many columns (17 KiB each)
+    constexpr unsigned GPU_HEIGHT_CACHE_COLUMNS = 1024;
+    // gpu backend, terrainMode 1: mesh chunks without lod seams straight from
+    // the column heights, walking each column's surface crossings instead of
+    // marching all 65^3 points (see shaders/heightfield.comp)
+    constexpr bool GPU_HEIGHTFIELD_MESHER = true;
+    // heightfield chunks taken off the queue together; each pass is dispatched
+    // once per batch (gl_WorkGroupID.z picks the chunk). 1 = one chunk at a time
+    constexpr unsigned GPU_BATCH_SIZE = 32;
+
+    // frame profiler (see Profiler): cpu zones and gpu timer queries of the
+    // main and worker threads, the last PROFILER_EVENTS zones per thread and
+    // PROFILER_FRAMES frames kept. F12 writes them to PROFILER_TRACE_FILE as
+    // chrome trace json
+    constexpr bool PROFILER = true;
+    constexpr unsigned PROFILER_EVENTS = 1u << 16;
+    constexpr unsigned PROFILER_FRAMES = 1024;
+    const char* const PROFILER_TRACE_FILE = "trace.json";
+
+    // frustum-cull chunks in a compute pass instead of per chunk on the cpu
+    constexpr bool GPU_CULLING = true;
+    // also drop chunks hidden behind last frame's depth (needs GPU_CULLING)
+    constexpr bool GPU_OCCLUSION_CULLING = true;
+
+    constexpr float RENDER_DISTANCE = 4000.0f; // coarsest lod reaches ~3.3 km
     constexpr float NEAR_PLANE = 0.1f;
     constexpr float FOV = 45.0f;
 
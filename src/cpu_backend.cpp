@@ -0,0 +1,447 @@
+#include "cpu_backend.h"
+#include "snoise.h"
+#include "terrain.h"
+#include "marching_cubes.h"
+#include "worker_types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+    using namespace Terrain;
+
+    const glm::ivec3 cornerOffsets[8] = {
+        {0,0,0}, {1,0,0}, {1,0,1}, {0,0,1},
+        {0,1,0}, {1,1,0}, {1,1,1}, {0,1,1}
+    };
+
+    // for every cube edge, the corner owning it (offset from the voxel) and
+    // the axis it runs along from there
+    const glm::ivec4 edgeOwner[12] = {
+        {0,0,0,0}, {1,0,0,2}, {0,0,1,0}, {0,0,0,2},
+        {0,1,0,0}, {1,1,0,2}, {0,1,1,0}, {0,1,0,2},
+        {0,0,0,1}, {1,0,0,1}, {1,0,1,1}, {0,0,1,1}
+    };
+
+    const glm::ivec3 axisSteps[3] = { {1,0,0}, {0,1,0}, {0,0,1} };
+
+    inline float shape_density(float density) {
+        return density > 0.0f ? std::pow(density, DENSITY_EXP) : density;
+    }
+
+    inline int cube_index(const float* v) {
+        int cubeIndex = 0;
+        for (int i = 0; i < 8; ++i) {
+            if (v[i] > Config::ISOLEVEL) cubeIndex |= 1 << i;
+        }
+        return cubeIndex;
+    }
+
+    inline void load_corners(const float* densities, int x, int y, int z, float* v) {
+        for (int i = 0; i < 8; ++i) {
+            v[i] = densities[CpuMesher::density_index(x + cornerOffsets[i].x, y + cornerOffsets[i].y, z + cornerOffsets[i].z)];
+        }
+    }
+
+    inline uint32_t tri_index_count(int cubeIndex) {
+        if (edgeTable[cubeIndex] == 0) return 0;
+        uint32_t n = 0;
+        while (n < 16 && triTable[cubeIndex][n] != -1) n++;
+        return n;
+    }
+
+    inline bool is_voxel(const glm::ivec3& p) {
+        return p.x < Config::CHUNK_WIDTH && p.y < Config::CHUNK_HEIGHT && p.z < Config::CHUNK_DEPTH;
+    }
+
+    // bit a set when the point's edge along axis a lies in the chunk and the
+    // surface crosses it; its vertices are stored in axis order
+    inline uint32_t owned_edges(const float* densities, const glm::ivec3& p) {
+        const glm::ivec3 last(Config::CHUNK_WIDTH, Config::CHUNK_HEIGHT, Config::CHUNK_DEPTH);
+        bool inside = densities[CpuMesher::density_index(p.x, p.y, p.z)] > Config::ISOLEVEL;
+        uint32_t edges = 0;
+        for (int a = 0; a < 3; ++a) {
+            if (p[a] == last[a]) continue;
+            glm::ivec3 q = p + axisSteps[a];
+            if ((densities[CpuMesher::density_index(q.x, q.y, q.z)] > Config::ISOLEVEL) != inside) {
+                edges |= 1u << a;
+            }
+        }
+        return edges;
+    }
+
+    glm::vec3 interpolate_vertex(const glm::vec3& p1, const glm::vec3& p2, float v1, float v2) {
+        if (std::fabs(v1 - v2) < 0.00001f) return p1;
+        float t = (Config::ISOLEVEL - v1) / (v2 - v1);
+        return glm::mix(p1, p2, std::clamp(t, 0.0f, 1.0f));
+    }
+
+    glm::vec3 calculate_normal(const float* densities, const glm::ivec3& pos) {
+        int x0 = std::clamp(pos.x - 1, 0, Config::CHUNK_WIDTH);
+        int x1 = std::clamp(pos.x + 1, 0, Config::CHUNK_WIDTH);
+        int y0 = std::clamp(pos.y - 1, 0, Config::CHUNK_HEIGHT);
+        int y1 = std::clamp(pos.y + 1, 0, Config::CHUNK_HEIGHT);
+        int z0 = std::clamp(pos.z - 1, 0, Config::CHUNK_DEPTH);
+        int z1 = std::clamp(pos.z + 1, 0, Config::CHUNK_DEPTH);
+
+        using CpuMesher::density_index;
+        glm::vec3 gradient(
+            densities[density_index(x1, pos.y, pos.z)] - densities[density_index(x0, pos.y, pos.z)],
+            densities[density_index(pos.x, y1, pos.z)] - densities[density_index(pos.x, y0, pos.z)],
+            densities[density_index(pos.x, pos.y, z1)] - densities[density_index(pos.x, pos.y, z0)]);
+
+        // normal points toward lower density
+        return glm::normalize(-gradient);
+    }
+
+    glm::vec3 interpolate_normal(const float* densities, const glm::ivec3& corner0, const glm::ivec3& corner1, float v0, float v1) {
+        glm::vec3 n0 = calculate_normal(densities, corner0);
+        glm::vec3 n1 = calculate_normal(densities, corner1);
+
+        float t = std::fabs(v1 - v0) < 0.00001f ? 0.5f : (Config::ISOLEVEL - v0) / (v1 - v0);
+        t = std::clamp(t, 0.0f, 1.0f);
+
+        return glm::normalize(glm::mix(n0, n1, t));
+    }
+
+    // keep the seam functions in sync with shaders/mc_stitch.comp and mc_emit.comp
+    constexpr int SEAM_WIDTH = Config::CHUNK_WIDTH; // chunks are cubic
+    static_assert(Config::CHUNK_WIDTH == Config::CHUNK_HEIGHT && Config::CHUNK_WIDTH == Config::CHUNK_DEPTH,
+                  "lod seams assume cubic chunks");
+
+    glm::ivec3 face_point(int axis, int plane, int u, int w) {
+        glm::ivec3 p;
+        p[axis] = plane;
+        p[(axis + 1) % 3] = u;
+        p[(axis + 2) % 3] = w;
+        return p;
+    }
+
+    float face_density(const float* densities, int axis, int plane, int u, int w) {
+        glm::ivec3 p = face_point(axis, plane, u, w);
+        return densities[CpuMesher::density_index(p.x, p.y, p.z)];
+    }
+
+    glm::vec2 coarse_crossing(const glm::vec2& c0, const glm::vec2& c1, float v0, float v1) {
+        if (std::fabs(v0 - v1) < 0.00001f) return c0;
+        float t = (Config::ISOLEVEL - v0) / (v1 - v0);
+        return glm::mix(c0, c1, std::clamp(t, 0.0f, 1.0f));
+    }
+
+    glm::vec3 seam_vertex(const float* densities, const CpuMesher::Seams& seams, const glm::vec3& v,
+                          int axis, int plane, const glm::ivec3& pa, const glm::ivec3& pb) {
+        const float INV_STEP = 1022.0f / 64.0f;
+        int ua = (axis + 1) % 3;
+        int wa = (axis + 2) % 3;
+        glm::vec2 off = glm::vec2(float(seams.parity[ua]), float(seams.parity[wa])) * float(SEAM_WIDTH);
+
+        glm::ivec2 s0(std::min(std::min(pa[ua], pb[ua]) & ~1, SEAM_WIDTH - 2),
+                      std::min(std::min(pa[wa], pb[wa]) & ~1, SEAM_WIDTH - 2));
+        glm::ivec2 s1 = s0 + 2;
+        float d00 = face_density(densities, axis, plane, s0.x, s0.y);
+        float d10 = face_density(densities, axis, plane, s1.x, s0.y);
+        float d01 = face_density(densities, axis, plane, s0.x, s1.y);
+        float d11 = face_density(densities, axis, plane, s1.x, s1.y);
+        glm::vec2 c00 = (glm::vec2(s0) + off) * 0.5f;
+        glm::vec2 c11 = (glm::vec2(s1) + off) * 0.5f;
+        glm::vec2 c10(c11.x, c00.y);
+        glm::vec2 c01(c00.x, c11.y);
+
+        glm::vec2 p;
+        bool alongU = pa[ua] != pb[ua];
+        int across = alongU ? pa[wa] : pa[ua];
+        if ((across & 1) == 0) {
+            if (alongU) {
+                p = across == s0.y ? coarse_crossing(c00, c10, d00, d10) : coarse_crossing(c01, c11, d01, d11);
+            } else {
+                p = across == s0.x ? coarse_crossing(c00, c01, d00, d01) : coarse_crossing(c10, c11, d10, d11);
+            }
+        } else {
+            // inside the square: onto an end of its coarse contour segment, so
+            // each fine edge on the face is a coarse one or collapses
+            glm::vec2 bottom = coarse_crossing(c00, c10, d00, d10);
+            glm::vec2 right = coarse_crossing(c10, c11, d10, d11);
+            glm::vec2 top = coarse_crossing(c01, c11, d01, d11);
+            glm::vec2 left = coarse_crossing(c00, c01, d00, d01);
+            bool i00 = d00 > Config::ISOLEVEL, i10 = d10 > Config::ISOLEVEL;
+            bool i01 = d01 > Config::ISOLEVEL, i11 = d11 > Config::ISOLEVEL;
+            bool hasBottom = i00 != i10, hasRight = i10 != i11, hasTop = i01 != i11, hasLeft = i00 != i01;
+            glm::vec2 vc = (glm::vec2(v[ua], v[wa]) + off) * 0.5f;
+
+            if (hasBottom && hasRight && hasTop && hasLeft) {
+                // the centre is outside (stitch_density), so the edge runs
+                // from it to an inside midpoint, part of that corner's cut
+                if (alongU) {
+                    p = std::min(pa[ua], pb[ua]) == s0.x ? left : right;
+                } else {
+                    p = std::min(pa[wa], pb[wa]) == s0.y ? bottom : top;
+                }
+            } else {
+                glm::vec2 e[2];
+                int n = 0;
+                if (hasBottom) e[n++] = bottom;
+                if (hasRight && n < 2) e[n++] = right;
+                if (hasTop && n < 2) e[n++] = top;
+                if (hasLeft && n < 2) e[n++] = left;
+                p = n < 2 ? vc : glm::distance(vc, e[0]) <= glm::distance(vc, e[1]) ? e[0] : e[1];
+            }
+        }
+
+        glm::vec2 q = glm::floor(p * INV_STEP + 0.5f);
+        glm::vec2 f = q * (2.0f / INV_STEP) - off;
+        glm::vec3 r;
+        r[axis] = float(plane);
+        r[ua] = f.x;
+        r[wa] = f.y;
+        return r;
+    }
+
+    glm::vec3 stitch_vertex(const float* densities, const CpuMesher::Seams& seams, const glm::vec3& v,
+                            const glm::ivec3& pa, const glm::ivec3& pb) {
+        if (seams.mask == 0) return v;
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int side = 0; side < 2; ++side) {
+                if ((seams.mask & (1u << (2 * axis + side))) == 0) continue;
+                int plane = side * SEAM_WIDTH;
+                if (pa[axis] == plane && pb[axis] == plane) {
+                    return seam_vertex(densities, seams, v, axis, plane, pa, pb);
+                }
+            }
+        }
+        return v;
+    }
+}
+
+void CpuMesher::fill_density(const glm::vec3& chunkWorldPos, float voxelScale, int terrainMode, float* densities, int zBegin, int zEnd) {
+    // 3D noise terrain generation, one z-plane of sample points per noise batch
+    if (terrainMode == 0) {
+        constexpr size_t PLANE = size_t(POINTS_X) * POINTS_Y;
+        std::vector<float> sx(PLANE), sy(PLANE), sz(PLANE), px(PLANE), py(PLANE), pz(PLANE), n(PLANE), noise(PLANE);
+
+        for (int z = zBegin; z < zEnd; ++z) {
+            for (int y = 0; y < POINTS_Y; ++y) {
+                for (int x = 0; x < POINTS_X; ++x) {
+                    size_t i = size_t(y) * POINTS_X + x;
+                    sx[i] = (chunkWorldPos.x + float(x) * voxelScale) * 0.5f;
+                    sy[i] = (chunkWorldPos.y + float(y) * voxelScale) * 0.25f;
+                    sz[i] = (chunkWorldPos.z + float(z) * voxelScale) * 0.5f;
+                    noise[i] = 0.0f;
+                }
+            }
+
+            float frequency = BASE_FREQUENCY_3D;
+            float amplitude = BASE_AMPLITUDE_3D;
+            for (int o = 0; o < OCTAVES_3D; ++o) {
+                for (size_t i = 0; i < PLANE; ++i) {
+                    px[i] = sx[i] * frequency;
+                    py[i] = sy[i] * frequency;
+                    pz[i] = sz[i] * frequency;
+                }
+                snoise_batch(px.data(), py.data(), pz.data(), n.data(), PLANE);
+                for (size_t i = 0; i < PLANE; ++i) {
+                    noise[i] += n[i] * amplitude;
+                }
+                amplitude *= PERSISTENCE_3D;
+                frequency *= LACUNARITY_3D;
+            }
+
+            float* plane = densities + density_index(0, 0, z);
+            for (size_t i = 0; i < PLANE; ++i) {
+                float density = -(sy[i] + FLOOR_OFFSET) + std::exp2(noise[i]) * NOISE_WEIGHT_3D;
+                plane[i] = shape_density(density);
+            }
+        }
+        return;
+    }
+
+    // 2D noise terrain generation, every (x, z) column of the slab in one batch
+    const size_t columns = size_t(POINTS_X) * size_t(std::max(zEnd - zBegin, 0));
+    std::vector<float> sx(columns), sz(columns), px(columns), pz(columns), n(columns), noise(columns, 0.0f);
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int x = 0; x < POINTS_X; ++x) {
+            size_t i = size_t(z - zBegin) * POINTS_X + x;
+            sx[i] = (chunkWorldPos.x + float(x) * voxelScale) * 0.5f;
+            sz[i] = (chunkWorldPos.z + float(z) * voxelScale) * 0.5f;
+        }
+    }
+
+    float frequency = BASE_FREQUENCY_2D;
+    float amplitude = BASE_AMPLITUDE_2D;
+    for (int o = 0; o < OCTAVES_2D; ++o) {
+        for (size_t i = 0; i < columns; ++i) {
+            px[i] = sx[i] * frequency;
+            pz[i] = sz[i] * frequency;
+        }
+        snoise_batch(px.data(), pz.data(), n.data(), columns);
+        for (size_t i = 0; i < columns; ++i) {
+            noise[i] += n[i] * amplitude;
+        }
+        amplitude *= PERSISTENCE_2D;
+        frequency *= LACUNARITY_2D;
+    }
+
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int x = 0; x < POINTS_X; ++x) {
+            float height = std::pow(1.6f, noise[size_t(z - zBegin) * POINTS_X + x]) * NOISE_WEIGHT_2D;
+
+            for (int y = 0; y < POINTS_Y; ++y) {
+                float worldY_scaled = (chunkWorldPos.y + float(y) * voxelScale) * 0.25f;
+                float density = -(worldY_scaled + FLOOR_OFFSET) + height;
+                densities[density_index(x, y, z)] = shape_density(density);
+            }
+        }
+    }
+}
+
+CpuMesher::Seams CpuMesher::seams_of(const GenJob& job) {
+    Seams s;
+    s.mask = job.seams;
+    s.parity = glm::ivec3(job.key.x & 1, job.key.y & 1, job.key.z & 1);
+    return s;
+}
+
+void CpuMesher::stitch_density(float* densities, uint32_t seamMask) {
+    for (int face = 0; face < 6; ++face) {
+        if ((seamMask & (1u << face)) == 0) continue;
+        int axis = face >> 1;
+        int plane = (face & 1) * SEAM_WIDTH;
+        for (int w = 0; w <= SEAM_WIDTH; ++w) {
+            for (int u = 0; u <= SEAM_WIDTH; ++u) {
+                bool oddU = (u & 1) != 0;
+                bool oddW = (w & 1) != 0;
+                if (!oddU && !oddW) continue;
+                glm::ivec2 lo(u - (oddU ? 1 : 0), w - (oddW ? 1 : 0));
+                glm::ivec2 hi(u + (oddU ? 1 : 0), w + (oddW ? 1 : 0));
+
+                // reads only even points, which are never written
+                float d;
+                if (oddU && oddW) {
+                    float d00 = face_density(densities, axis, plane, lo.x, lo.y);
+                    float d10 = face_density(densities, axis, plane, hi.x, lo.y);
+                    float d01 = face_density(densities, axis, plane, lo.x, hi.y);
+                    float d11 = face_density(densities, axis, plane, hi.x, hi.y);
+                    d = ((d00 + d10) + (d01 + d11)) * 0.25f;
+                    // saddle: the coarse mesh cuts off both inside corners (its
+                    // table does on every ambiguous face), so the centre goes out
+                    bool i00 = d00 > Config::ISOLEVEL, i10 = d10 > Config::ISOLEVEL;
+                    if (i00 == (d11 > Config::ISOLEVEL) && i10 == (d01 > Config::ISOLEVEL) && i00 != i10) {
+                        d = std::min(d, Config::ISOLEVEL);
+                    }
+                } else {
+                    d = (face_density(densities, axis, plane, lo.x, lo.y) + face_density(densities, axis, plane, hi.x, hi.y)) * 0.5f;
+                }
+                glm::ivec3 p = face_point(axis, plane, u, w);
+                densities[density_index(p.x, p.y, p.z)] = d;
+            }
+        }
+    }
+}
+
+CpuMesher::Counts CpuMesher::count(const float* densities, Counts* offsets, int zBegin, int zEnd) {
+    Counts running;
+    float v[8];
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int y = 0; y < POINTS_Y; ++y) {
+            for (int x = 0; x < POINTS_X; ++x) {
+                glm::ivec3 p(x, y, z);
+                offsets[density_index(x, y, z)] = running;
+                running.vertices += uint32_t(std::popcount(owned_edges(densities, p)));
+                if (is_voxel(p)) {
+                    load_corners(densities, x, y, z, v);
+                    running.indices += tri_index_count(cube_index(v));
+                }
+            }
+        }
+    }
+    return running;
+}
+
+void CpuMesher::emit(const float* densities, const Counts* offsets, const Counts& base, uint32_t nextVertexBase,
+                     glm::uvec2* vertices, uint32_t* indices, int zBegin, int zEnd, const Seams& seams) {
+    float cv[8];
+    for (int z = zBegin; z < zEnd; ++z) {
+        for (int y = 0; y < POINTS_Y; ++y) {
+            for (int x = 0; x < POINTS_X; ++x) {
+                glm::ivec3 p(x, y, z);
+                const Counts& off = offsets[density_index(x, y, z)];
+
+                // one vertex per owned edge the surface crosses
+                uint32_t edges = owned_edges(densities, p);
+                uint32_t w = base.vertices + off.vertices;
+                for (int a = 0; a < 3; ++a) {
+                    if ((edges & (1u << a)) == 0) continue;
+                    glm::ivec3 q = p + axisSteps[a];
+                    float dp = densities[density_index(p.x, p.y, p.z)];
+                    float dq = densities[density_index(q.x, q.y, q.z)];
+                    glm::vec3 v = stitch_vertex(densities, seams, interpolate_vertex(glm::vec3(p), glm::vec3(q), dp, dq), p, q);
+                    glm::vec3 n = interpolate_normal(densities, p, q, dp, dq);
+                    vertices[w++] = glm::uvec2(pack_position(v), pack_oct(n));
+                }
+
+                // the voxel's triangles, pointing at the vertices of the edges' owners
+                if (!is_voxel(p)) continue;
+                load_corners(densities, x, y, z, cv);
+                int cubeIndex = cube_index(cv);
+                if (edgeTable[cubeIndex] == 0) continue;
+
+                uint32_t i = base.indices + off.indices;
+                const int* tri = triTable[cubeIndex];
+                for (int k = 0; k < 16 && tri[k] != -1; ++k) {
+                    const glm::ivec4& e = edgeOwner[tri[k]];
+                    glm::ivec3 owner = p + glm::ivec3(e);
+                    uint32_t ownerBase = owner.z == zEnd ? nextVertexBase : base.vertices;
+                    uint32_t rank = uint32_t(std::popcount(owned_edges(densities, owner) & ((1u << e.w) - 1u)));
+                    indices[i++] = ownerBase + offsets[density_index(owner.x, owner.y, owner.z)].vertices + rank;
+                }
+            }
+        }
+    }
+}
+
+// packing chunk-local position data to 10 bits per axis, 1022 steps per
+// chunk as in mc_emit.comp
+uint32_t CpuMesher::pack_position(const glm::vec3& localPos) {
+    const float INV_STEP = 1022.0f / 64.0f;
+    glm::vec3 q = glm::clamp(localPos, glm::vec3(0.0f), glm::vec3(64.0f)) * INV_STEP;
+    glm::uvec3 iu(glm::floor(q + 0.5f));
+    return (iu.x & 1023u) | ((iu.y & 1023u) << 10) | ((iu.z & 1023u) << 20);
+}
+
+// packing normal data to oct-encoded 11+11 bits
+uint32_t CpuMesher::pack_oct(const glm::vec3& nIn) {
+    glm::vec3 n = glm::normalize(nIn);
+    glm::vec3 a = glm::abs(n);
+    float l1 = a.x + a.y + a.z;
+    glm::vec2 p;
+    if (n.z >= 0.0f) {
+        p = glm::vec2(n.x, n.y) / l1;
+    } else {
+        p = glm::vec2((1.0f - a.y / l1) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - a.x / l1) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    p = p * 0.5f + 0.5f;
+
+    const uint32_t NB = 11u;
+    const float NQ = float((1u << NB) - 1u);
+    uint32_t u = uint32_t(std::round(std::clamp(p.x, 0.0f, 1.0f) * NQ));
+    uint32_t v = uint32_t(std::round(std::clamp(p.y, 0.0f, 1.0f) * NQ));
+    return u | (v << NB);
+}
+
+CpuChunkBackend::CpuChunkBackend(int terrainMode)
+    : terrainMode(terrainMode), densities(CpuMesher::NUM_POINTS), offsets(CpuMesher::NUM_POINTS) {}
+
+CpuMesher::Counts CpuChunkBackend::generate(const GenJob& job, std::vector<glm::uvec2>& vertices, std::vector<uint32_t>& indices) {
+    CpuMesher::fill_density(job.worldPos, lod_scale(job.key.lod), terrainMode, densities.data());
+    CpuMesher::Seams seams = CpuMesher::seams_of(job);
+    CpuMesher::stitch_density(densities.data(), seams.mask);
+    CpuMesher::Counts total = CpuMesher::count(densities.data(), offsets.data());
+    vertices.resize(total.vertices);
+    indices.resize(total.indices);
+    if (total.indices > 0) {
+        CpuMesher::emit(densities.data(), offsets.data(), CpuMesher::Counts{}, 0, vertices.data(), indices.data(),
+                        0, CpuMesher::POINTS_Z, seams);
+    }
+    return total;
+}
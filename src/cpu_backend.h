@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "config.h"
+
+struct GenJob;
+
+// cpu mirror of the density.comp -> mc_count.comp -> mc_emit.comp pipeline.
+// the stage functions work on z-slabs of density points [zBegin, zEnd) so
+// callers can split a chunk across threads; defaults cover the whole chunk.
+// meshes are indexed: every density point owns the +x, +y and +z edges leaving
+// it, one vertex per crossed edge, and the voxel whose corner 0 it is.
+namespace CpuMesher {
+    constexpr int POINTS_X = Config::CHUNK_WIDTH + 1;
+    constexpr int POINTS_Y = Config::CHUNK_HEIGHT + 1;
+    constexpr int POINTS_Z = Config::CHUNK_DEPTH + 1;
+    constexpr size_t NUM_POINTS = size_t(POINTS_X) * POINTS_Y * POINTS_Z;
+
+    inline size_t density_index(int x, int y, int z) {
+        return (size_t(z) * POINTS_Y + y) * POINTS_X + x;
+    }
+    inline size_t voxel_index(int x, int y, int z) {
+        return (size_t(z) * Config::CHUNK_HEIGHT + y) * Config::CHUNK_WIDTH + x;
+    }
+
+    // density.comp: fills density points with z in [zBegin, zEnd), voxelScale
+    // world units apart
+    void fill_density(const glm::vec3& chunkWorldPos, float voxelScale, int terrainMode, float* densities,
+                      int zBegin = 0, int zEnd = POINTS_Z);
+
+    // lod seams of a chunk: faces bordering a chunk of twice the voxel size and
+    // which half of that chunk's face each of ours covers
+    struct Seams {
+        uint32_t mask = 0;     // bit 2 * axis + (0 low, 1 high side)
+        glm::ivec3 parity{0};  // chunk coordinate & 1
+    };
+
+    Seams seams_of(const GenJob& job);
+
+    // mc_stitch.comp: on the seam faces, replaces the samples the coarse chunk
+    // lacks with the interpolation of the ones it has. runs between density and count
+    void stitch_density(float* densities, uint32_t seamMask);
+
+    struct Counts {
+        uint32_t vertices = 0;
+        uint32_t indices = 0;
+    };
+
+    // mc_count.comp: writes per-point offsets of the vertices and indices the
+    // points with z in [zBegin, zEnd) emit, relative to the start of the slab,
+    // and returns the slab totals. offsets is indexed like densities
+    Counts count(const float* densities, Counts* offsets,
+                 int zBegin = 0, int zEnd = POINTS_Z);
+
+    // mc_emit.comp: writes the slab's packed vertices at base.vertices + offsets
+    // and its indices at base.indices + offsets, moving seam face vertices onto
+    // the coarse neighbour's contour. indices count from the chunk's first
+    // vertex; nextVertexBase is where the slab starting at zEnd put its vertices
+    void emit(const float* densities, const Counts* offsets, const Counts& base, uint32_t nextVertexBase,
+              glm::uvec2* vertices, uint32_t* indices, int zBegin = 0, int zEnd = POINTS_Z,
+              const Seams& seams = Seams{});
+
+    // same packing as mc_emit.comp / decoding in shader.vs
+    uint32_t pack_position(const glm::vec3& localPos);
+    uint32_t pack_oct(const glm::vec3& n);
+}
+
+// single-chunk cpu backend, owns the per-chunk scratch so repeated jobs do not reallocate
+class CpuChunkBackend {
+public:
+    explicit CpuChunkBackend(int terrainMode = Config::TERRAIN_MODE);
+
+    // runs all three passes for job and replaces vertices / indices with the
+    // packed uvec2 stream and its triangles. returns their counts (the values
+    // mc_count.comp leaves in vertex_total / index_total)
+    CpuMesher::Counts generate(const GenJob& job, std::vector<glm::uvec2>& vertices, std::vector<uint32_t>& indices);
+
+private:
+    int terrainMode;
+    std::vector<float> densities;
+    std::vector<CpuMesher::Counts> offsets;
+};
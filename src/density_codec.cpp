@@ -0,0 +1,228 @@
+#include "density_codec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+namespace {
+    using namespace DensityCodec;
+
+    constexpr char MAGIC[4] = { 'T', 'D', 'E', 'N' };
+    constexpr uint32_t VERSION = 1;
+    // shortest run worth a control byte of its own; longest one it can hold
+    constexpr size_t MIN_RUN = 3;
+    constexpr size_t MAX_RUN = 255 - 125;
+    constexpr size_t MAX_LITERALS = 128;
+
+    int max_step(int bits) {
+        return (1 << (bits - 1)) - 1;
+    }
+
+    template<typename T>
+    void put(std::vector<uint8_t>& out, T item) {
+        uint8_t b[sizeof(T)];
+        std::memcpy(b, &item, sizeof(T));
+        out.insert(out.end(), b, b + sizeof(T));
+    }
+
+    template<typename T>
+    T get(const uint8_t* p) {
+        T item;
+        std::memcpy(&item, p, sizeof(T));
+        return item;
+    }
+
+    // isolevel + q steps; q <= 0 decodes to at most the isolevel, so it stays outside
+    template<typename T>
+    std::vector<T> quantize(const float* densities, size_t points, const Quantization& q) {
+        const float steps = float(max_step(q.bits));
+        const float scale = steps / q.range;
+        std::vector<T> items(points);
+        for (size_t i = 0; i < points; ++i) {
+            float d = densities[i];
+            int s = int(std::lround(std::clamp((d - q.isolevel) * scale, -steps, steps)));
+            items[i] = T(d > q.isolevel ? std::max(s, 1) : std::min(s, 0));
+        }
+        return items;
+    }
+
+    template<typename T>
+    void pack_runs(const std::vector<T>& items, std::vector<uint8_t>& out) {
+        const size_t n = items.size();
+        auto run_at = [&](size_t i, size_t limit) {
+            size_t r = 1;
+            while (i + r < n && r < limit && items[i + r] == items[i]) ++r;
+            return r;
+        };
+        size_t i = 0;
+        while (i < n) {
+            size_t run = run_at(i, MAX_RUN);
+            if (run >= MIN_RUN) {
+                out.push_back(uint8_t(run + 125));
+                put(out, items[i]);
+                i += run;
+                continue;
+            }
+            // literals up to the next run worth encoding
+            size_t start = i;
+            while (i < n && i - start < MAX_LITERALS && run_at(i, MIN_RUN) < MIN_RUN) ++i;
+            out.push_back(uint8_t(i - start - 1));
+            for (size_t k = start; k < i; ++k) {
+                put(out, items[k]);
+            }
+        }
+    }
+
+    template<typename T>
+    void encode_items(const float* densities, size_t points, const Quantization& q, RecordHeader& h,
+                      std::vector<uint8_t>& out) {
+        const std::vector<T> items = quantize<T>(densities, points, q);
+        const size_t payloadStart = out.size();
+
+        if (std::all_of(items.begin(), items.end(), [&](T v) { return v == items[0]; })) {
+            h.encoding = uint8_t(Encoding::Uniform);
+            put(out, items[0]);
+        } else {
+            h.encoding = uint8_t(Encoding::Rle);
+            pack_runs(items, out);
+            if (out.size() - payloadStart > items.size() * sizeof(T)) {
+                // noise all the way through: runs only cost control bytes
+                out.resize(payloadStart);
+                h.encoding = uint8_t(Encoding::Raw);
+                for (T v : items) {
+                    put(out, v);
+                }
+            }
+        }
+        h.payloadBytes = uint32_t(out.size() - payloadStart);
+    }
+
+    template<typename T>
+    bool decode_items(const RecordHeader& h, const uint8_t* p, float* densities, size_t points) {
+        const uint8_t* end = p + h.payloadBytes;
+        const float step = h.range / float(max_step(h.bits));
+        auto value = [&](T q) { return h.isolevel + float(q) * step; };
+
+        switch (Encoding(h.encoding)) {
+        case Encoding::Uniform:
+            if (h.payloadBytes != sizeof(T)) return false;
+            std::fill(densities, densities + points, value(get<T>(p)));
+            return true;
+        case Encoding::Raw:
+            if (h.payloadBytes != points * sizeof(T)) return false;
+            for (size_t i = 0; i < points; ++i) {
+                densities[i] = value(get<T>(p + i * sizeof(T)));
+            }
+            return true;
+        case Encoding::Rle: {
+            size_t i = 0;
+            while (i < points) {
+                if (p == end) return false;
+                uint8_t c = *p++;
+                if (c < MAX_LITERALS) {
+                    size_t count = size_t(c) + 1;
+                    if (i + count > points || size_t(end - p) < count * sizeof(T)) return false;
+                    for (size_t k = 0; k < count; ++k, p += sizeof(T)) {
+                        densities[i++] = value(get<T>(p));
+                    }
+                } else {
+                    size_t count = size_t(c) - 125;
+                    if (i + count > points || size_t(end - p) < sizeof(T)) return false;
+                    std::fill(densities + i, densities + i + count, value(get<T>(p)));
+                    p += sizeof(T);
+                    i += count;
+                }
+            }
+            return p == end;
+        }
+        }
+        return false;
+    }
+}
+
+float DensityCodec::stepSize(const Quantization& q) {
+    return q.range / float(max_step(q.bits == 8 ? 8 : 16));
+}
+
+void DensityCodec::encode(const ChunkKey& key, const float* densities, const Quantization& q, std::vector<uint8_t>& out,
+                          size_t points) {
+    RecordHeader h{};
+    h.x = key.x; h.y = key.y; h.z = key.z; h.lod = key.lod;
+    h.bits = uint8_t(q.bits == 8 ? 8 : 16);
+    h.range = q.range;
+    h.isolevel = q.isolevel;
+
+    const size_t headerAt = out.size();
+    out.resize(headerAt + sizeof(RecordHeader));
+    Quantization used = q;
+    used.bits = h.bits;
+    if (h.bits == 8) {
+        encode_items<int8_t>(densities, points, used, h, out);
+    } else {
+        encode_items<int16_t>(densities, points, used, h, out);
+    }
+    std::memcpy(out.data() + headerAt, &h, sizeof(h));
+}
+
+bool DensityCodec::decode(const RecordHeader& header, const uint8_t* payload, float* densities, size_t points) {
+    if (!(header.range > 0.0f)) return false;
+    if (header.bits == 8) return decode_items<int8_t>(header, payload, densities, points);
+    if (header.bits == 16) return decode_items<int16_t>(header, payload, densities, points);
+    return false;
+}
+
+DensityCodec::Writer::Writer(std::ostream& out_, const Quantization& q, size_t points_)
+    : out(out_), quant(q), points(points_) {
+    StreamHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.points = uint32_t(points);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    written = sizeof(h);
+}
+
+bool DensityCodec::Writer::write(const ChunkKey& key, const float* densities) {
+    return write(key, densities, quant);
+}
+
+bool DensityCodec::Writer::write(const ChunkKey& key, const float* densities, const Quantization& q) {
+    record.clear();
+    encode(key, densities, q, record, points);
+    out.write(reinterpret_cast<const char*>(record.data()), std::streamsize(record.size()));
+    written += record.size();
+    return ok();
+}
+
+bool DensityCodec::Writer::ok() const {
+    return bool(out);
+}
+
+DensityCodec::Reader::Reader(std::istream& in_, size_t points_) : in(in_), points(points_) {
+    StreamHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    good = in.gcount() == std::streamsize(sizeof(h)) && std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0
+        && h.version == VERSION && h.points == points;
+}
+
+bool DensityCodec::Reader::next(ChunkKey& key, float* densities) {
+    if (!good) return false;
+    RecordHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (in.gcount() == 0) {
+        return false; // end of stream
+    }
+    // no valid record is bigger than raw 16 bit items
+    if (in.gcount() != std::streamsize(sizeof(h)) || h.payloadBytes > points * sizeof(int16_t)) {
+        good = false;
+        return false;
+    }
+    payload.resize(h.payloadBytes);
+    in.read(reinterpret_cast<char*>(payload.data()), std::streamsize(h.payloadBytes));
+    if (in.gcount() != std::streamsize(h.payloadBytes) || !decode(h, payload.data(), densities, points)) {
+        good = false;
+        return false;
+    }
+    key = ChunkKey{ h.x, h.y, h.z, h.lod };
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+#include "config.h"
+#include "cpu_backend.h"
+#include "worker_types.h"
+
+// compact storage for a chunk's (CHUNK_WIDTH + 1)^3 density grid, indexed
+// like CpuMesher::density_index, for saving edited chunks. grids of another
+// size (TerrainEdits bricks) pass their number of points.
+//
+// samples are clamped to isolevel +- range and quantized to signed 8 or 16 bit
+// steps of range / (2^(bits - 1) - 1) around the isolevel, rounding so every
+// sample stays on its side of it: a decoded grid meshes to the same triangles,
+// only their vertices move. samples within range are off by at most half a
+// step, or one step right next to the isolevel. the quantized samples are then
+// stored one of three ways, whichever is smallest:
+//   Uniform: every sample the same (all air, all rock), one item
+//   Raw:     the items as they are
+//   Rle:     packbits runs; a control byte n < 128 is followed by n + 1
+//            literal items, n >= 128 by one item repeated n - 125 times
+// items are little-endian. a stream is a StreamHeader, then per grid a
+// RecordHeader and its payload
+namespace DensityCodec {
+    constexpr size_t NUM_POINTS = CpuMesher::NUM_POINTS;
+
+    enum class Encoding : uint8_t { Uniform, Raw, Rle };
+
+    struct Quantization {
+        int bits = Config::DENSITY_STORE_BITS; // 8 or 16
+        float range = Config::DENSITY_STORE_RANGE;
+        float isolevel = Config::ISOLEVEL;
+    };
+
+    struct RecordHeader {
+        int32_t x, y, z, lod;
+        uint8_t encoding; // Encoding
+        uint8_t bits;
+        uint16_t pad;
+        float range;
+        float isolevel;
+        uint32_t payloadBytes;
+    };
+    static_assert(sizeof(RecordHeader) == 32, "fixed on-disk layout");
+
+    struct StreamHeader {
+        char magic[4];  // "TDEN"
+        uint32_t version;
+        uint32_t points; // per grid
+    };
+
+    // what one quantized step is worth: a sample decodes to isolevel + an
+    // integer number of them
+    float stepSize(const Quantization& q);
+
+    // appends the record (header and payload) of densities, points samples, to out
+    void encode(const ChunkKey& key, const float* densities, const Quantization& q, std::vector<uint8_t>& out,
+                size_t points = NUM_POINTS);
+
+    // the RecordHeader and payload of one record, as written by encode; false if
+    // it is malformed or does not hold points samples
+    bool decode(const RecordHeader& header, const uint8_t* payload, float* densities, size_t points = NUM_POINTS);
+
+    // writes a stream header, then encodes one grid per write()
+    class Writer {
+    public:
+        explicit Writer(std::ostream& out, const Quantization& q = Quantization{}, size_t points = NUM_POINTS);
+
+        bool write(const ChunkKey& key, const float* densities);
+        // with q instead of the writer's quantization, e.g. a range fitted to
+        // each grid
+        bool write(const ChunkKey& key, const float* densities, const Quantization& q);
+
+        // header and records so far
+        uint64_t bytesWritten() const { return written; }
+        bool ok() const;
+
+    private:
+        std::ostream& out;
+        Quantization quant;
+        size_t points;
+        std::vector<uint8_t> record; // reused per grid
+        uint64_t written = 0;
+    };
+
+    class Reader {
+    public:
+        // reads and checks the stream header, which must be for grids of
+        // points samples; see ok()
+        explicit Reader(std::istream& in, size_t points = NUM_POINTS);
+
+        // the next grid; false at the end of the stream or on a malformed record
+        bool next(ChunkKey& key, float* densities);
+
+        // false if the header did not match or a read failed
+        bool ok() const { return good; }
+
+    private:
+        std::istream& in;
+        size_t points;
+        std::vector<uint8_t> payload; // reused per grid
+        bool good = false;
+    };
+}
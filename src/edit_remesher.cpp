@@ -0,0 +1,227 @@
+#include "edit_remesher.h"
+#include "chunk.h"
+#include "cpu_backend.h"
+#include <algorithm>
+
+namespace {
+    constexpr GLuint POINT_GROUPS_X = (Chunk::CHUNK_WIDTH + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Y = (Chunk::CHUNK_HEIGHT + 1 + 7) / 8;
+    constexpr GLuint POINT_GROUPS_Z = (Chunk::CHUNK_DEPTH + 1 + 7) / 8;
+    constexpr GLsizeiptr GRID_BYTES = GLsizeiptr(CpuMesher::NUM_POINTS * sizeof(float));
+    constexpr GLsizeiptr BRICK_BYTES = GLsizeiptr(TerrainEdits::BRICK_POINTS * sizeof(float));
+    constexpr GLsizeiptr TABLE_BYTES = GLsizeiptr(TerrainEdits::TABLE_SIZE * sizeof(uint32_t));
+
+    // uniforms of terrain.comp
+    void set_terrain_uniforms(GLuint prog, const glm::vec3& worldPos, int lod, int terrainMode, uint32_t heightBase) {
+        glUniform3fv(glGetUniformLocation(prog, "chunkWorldPos"), 1, &worldPos[0]);
+        glUniform1i(glGetUniformLocation(prog, "terrainMode"), terrainMode);
+        glUniform1f(glGetUniformLocation(prog, "voxelScale"), lod_scale(lod));
+        glUniform1ui(glGetUniformLocation(prog, "heightBase"), heightBase);
+    }
+
+    GLuint make_ssbo(GLsizeiptr bytes) {
+        GLuint b = 0;
+        glGenBuffers(1, &b);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, b);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+        return b;
+    }
+
+    glm::vec3 world_pos(const ChunkKey& k) {
+        return glm::vec3(k.x * Chunk::CHUNK_WIDTH, k.y * Chunk::CHUNK_HEIGHT, k.z * Chunk::CHUNK_DEPTH) * lod_scale(k.lod);
+    }
+}
+
+EditRemesher::EditRemesher(GLuint densityProgram, GLuint heightsProgram, GLuint mcCountProgram, GLuint mcEmitProgram,
+                           GLuint mcStitchProgram, GLuint tri, GLuint edge, GpuBufferPool* pool,
+                           int terrainMode_, uint32_t batch_)
+    : densityProg(densityProgram), mcCountProg(mcCountProgram), mcEmitProg(mcEmitProgram),
+      mcStitchProg(mcStitchProgram), triSSBO(tri), edgeSSBO(edge), buffers(pool), terrainMode(terrainMode_),
+      batch(std::max<uint32_t>(batch_, 1)), heightCache(heightsProgram, batch) {}
+
+void EditRemesher::syncBricks(TerrainEdits& edits) {
+    dirtyBricks.clear();
+    edits.takeDirtyBricks(dirtyBricks);
+    const std::vector<float>& deltas = edits.brickDeltas();
+    const size_t count = edits.brickCount();
+    if (count == 0) return;
+
+    if (count > deltaCapacity) {
+        // grow to twice what is needed and upload everything once
+        if (deltaSSBO) glDeleteBuffers(1, &deltaSSBO);
+        deltaCapacity = count * 2;
+        deltaSSBO = make_ssbo(GLsizeiptr(deltaCapacity) * BRICK_BYTES);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(count) * BRICK_BYTES, deltas.data());
+        counters.bricksUploaded += count;
+        counters.bytesUploaded += uint64_t(count) * BRICK_BYTES;
+        return;
+    }
+
+    // runs of consecutive slots in one call each
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, deltaSSBO);
+    for (size_t i = 0; i < dirtyBricks.size();) {
+        size_t j = i + 1;
+        while (j < dirtyBricks.size() && dirtyBricks[j] == dirtyBricks[j - 1] + 1) ++j;
+        const GLintptr first = GLintptr(dirtyBricks[i]) * BRICK_BYTES;
+        const GLsizeiptr bytes = GLsizeiptr(j - i) * BRICK_BYTES;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, first, bytes, reinterpret_cast<const char*>(deltas.data()) + first);
+        counters.bricksUploaded += j - i;
+        counters.bytesUploaded += uint64_t(bytes);
+        i = j;
+    }
+}
+
+void EditRemesher::remesh(TerrainEdits& edits, const std::vector<Request>& requests, std::vector<Mesh>& meshes) {
+    meshes.assign(requests.size(), Mesh{});
+    if (requests.empty()) return;
+    syncBricks(edits);
+    for (size_t first = 0; first < requests.size(); first += batch) {
+        size_t n = std::min<size_t>(batch, requests.size() - first);
+        remeshSlice(edits, requests.data() + first, n, meshes.data() + first);
+    }
+}
+
+void EditRemesher::remeshSlice(const TerrainEdits& edits, const Request* requests, size_t n, Mesh* meshes) {
+    if (counterStride == 0) {
+        GLint align = 0;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+        counterStride = std::max<GLsizeiptr>(align, 2 * sizeof(GLuint));
+        counterSSBO = make_ssbo(counterStride * GLsizeiptr(batch));
+        tableSSBO = make_ssbo(TABLE_BYTES * GLsizeiptr(batch));
+    }
+    while (densitySSBOs.size() < n) {
+        densitySSBOs.push_back(make_ssbo(GRID_BYTES));
+        offsetSSBOs.push_back(make_ssbo(GLsizeiptr(CpuMesher::NUM_POINTS * 2 * sizeof(GLuint))));
+    }
+
+    // brick tables of the whole slice in one upload; coarser chunks' point
+    // into bricks sampled for this slice
+    tables.resize(TerrainEdits::TABLE_SIZE * n);
+    sampled.clear();
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t* table = tables.data() + TerrainEdits::TABLE_SIZE * i;
+        if (requests[i].key.lod == 0) {
+            edits.brickTable(requests[i].key, table);
+        } else {
+            edits.sampleBricks(requests[i].key, table, sampled);
+        }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tableSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, TABLE_BYTES * GLsizeiptr(n), tables.data());
+    counters.bytesUploaded += uint64_t(TABLE_BYTES) * n;
+
+    const size_t sampledBricks = sampled.size() / TerrainEdits::BRICK_POINTS;
+    if (sampledBricks > 0) {
+        if (sampledBricks > sampledCapacity) {
+            if (sampledSSBO) glDeleteBuffers(1, &sampledSSBO);
+            sampledCapacity = sampledBricks * 2;
+            sampledSSBO = make_ssbo(GLsizeiptr(sampledCapacity) * BRICK_BYTES);
+        } else {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, sampledSSBO);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sampledBricks) * BRICK_BYTES, sampled.data());
+        counters.bricksUploaded += sampledBricks;
+        counters.bytesUploaded += uint64_t(sampledBricks) * BRICK_BYTES;
+    }
+
+    std::vector<uint32_t> heightBases(n, 0);
+    if (terrainMode == 1) {
+        for (size_t i = 0; i < n; ++i) {
+            heightBases[i] = heightCache.column(requests[i].key, world_pos(requests[i].key));
+        }
+        heightCache.flush();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, heightCache.buffer());
+    }
+
+    // density: the noise plus the overlay
+    glUseProgram(densityProg);
+    glUniform1i(glGetUniformLocation(densityProg, "useOverlay"), true);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, tableSSBO);
+    for (size_t i = 0; i < n; ++i) {
+        const ChunkKey& k = requests[i].key;
+        set_terrain_uniforms(densityProg, world_pos(k), k.lod, terrainMode, heightBases[i]);
+        glUniform1ui(glGetUniformLocation(densityProg, "brickTableBase"), GLuint(TerrainEdits::TABLE_SIZE * i));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, k.lod == 0 ? deltaSSBO : sampledSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBOs[i]);
+        glDispatchCompute(POINT_GROUPS_X, terrainMode == 0 ? POINT_GROUPS_Y : 1, POINT_GROUPS_Z);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // faces bordering a coarser lod
+    glUseProgram(mcStitchProg);
+    glUniform1f(glGetUniformLocation(mcStitchProg, "isolevel"), Config::ISOLEVEL);
+    for (size_t i = 0; i < n; ++i) {
+        if (requests[i].seams == 0) continue;
+        glUniform1ui(glGetUniformLocation(mcStitchProg, "seams"), requests[i].seams);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBOs[i]);
+        glDispatchCompute((Chunk::CHUNK_WIDTH+1+7)/8, (Chunk::CHUNK_WIDTH+1+7)/8, 6);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // count every chunk, then read all totals with one wait
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterSSBO);
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, counterStride * GLsizeiptr(n),
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glUseProgram(mcCountProg);
+    glUniform1f(glGetUniformLocation(mcCountProg, "isolevel"), Config::ISOLEVEL);
+    glUniform1i(glGetUniformLocation(mcCountProg, "sparseDensity"), false);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, triSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, edgeSSBO);
+    for (size_t i = 0; i < n; ++i) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBOs[i]);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 4, counterSSBO, counterStride * GLintptr(i), 2 * sizeof(GLuint));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, offsetSSBOs[i]);
+        glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    totals.resize(size_t(counterStride / sizeof(GLuint)) * n);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterSSBO);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counterStride * GLsizeiptr(n), totals.data());
+
+    // emit (packed uvec2 vertices, then 32-bit indices) into exact ranges
+    glUseProgram(mcEmitProg);
+    glUniform1f(glGetUniformLocation(mcEmitProg, "isolevel"), Config::ISOLEVEL);
+    glUniform1i(glGetUniformLocation(mcEmitProg, "sparseDensity"), false);
+    for (size_t i = 0; i < n; ++i) {
+        const GLuint* t = totals.data() + size_t(counterStride / sizeof(GLuint)) * i;
+        Mesh& m = meshes[i];
+        m.vertexCount = t[0];
+        m.indexCount = t[1];
+        counters.chunks++;
+        if (m.indexCount == 0) {
+            m.vertexCount = 0;
+            continue;
+        }
+        m.vertices = buffers->allocVertices(mesh_slots(m.vertexCount, m.indexCount));
+
+        const ChunkKey& k = requests[i].key;
+        glUniform1ui(glGetUniformLocation(mcEmitProg, "baseVertex"), m.vertices.first);
+        glUniform1ui(glGetUniformLocation(mcEmitProg, "vertexCapacity"), m.vertices.count);
+        glUniform1ui(glGetUniformLocation(mcEmitProg, "seams"), requests[i].seams);
+        glUniform3i(glGetUniformLocation(mcEmitProg, "seamParity"), k.x & 1, k.y & 1, k.z & 1);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, densitySSBOs[i]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m.vertices.buffer);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 4, counterSSBO, counterStride * GLintptr(i), 2 * sizeof(GLuint));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, offsetSSBOs[i]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m.vertices.buffer);
+        glDispatchCompute(POINT_GROUPS_X, POINT_GROUPS_Y, POINT_GROUPS_Z);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void EditRemesher::destroy() {
+    heightCache.destroy();
+    for (GLuint b : densitySSBOs) glDeleteBuffers(1, &b);
+    for (GLuint b : offsetSSBOs) glDeleteBuffers(1, &b);
+    densitySSBOs.clear();
+    offsetSSBOs.clear();
+    GLuint single[] = { deltaSSBO, sampledSSBO, tableSSBO, counterSSBO };
+    for (GLuint b : single) {
+        if (b) glDeleteBuffers(1, &b);
+    }
+    deltaSSBO = sampledSSBO = tableSSBO = counterSSBO = 0;
+    deltaCapacity = sampledCapacity = 0;
+    counterStride = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "config.h"
+#include "gpu_buffer_pool.h"
+#include "height_cache.h"
+#include "terrain_edits.h"
+#include "worker_types.h"
+
+// meshes edited chunks on the main thread with the worker's passes: density.comp
+// adds TerrainEdits' overlay to the noise, then mc_stitch, mc_count and mc_emit.
+// the overlay's bricks are mirrored in one buffer, uploading only the ones
+// written since the last call; coarser chunks read bricks sampled at their
+// points (TerrainEdits::sampleBricks), uploaded per call. the counts of all chunks of a call are read
+// back with one wait, then each chunk is emitted into an exact range; the
+// meshes are complete for any draw issued after the call. the programs must
+// be its own, not the worker's: uniforms are program state
+class EditRemesher {
+public:
+    struct Request {
+        ChunkKey key; // any lod
+        uint8_t seams = 0;
+    };
+
+    struct Mesh {
+        VertexRange vertices; // from the pool; empty when the chunk has no surface
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct Stats {
+        uint64_t chunks = 0;
+        uint64_t bricksUploaded = 0;
+        uint64_t bytesUploaded = 0; // bricks and brick tables
+    };
+
+    // heightsProgram: shaders/heights.comp, for terrainMode 1
+    EditRemesher(GLuint densityProgram, GLuint heightsProgram, GLuint mcCountProgram, GLuint mcEmitProgram,
+                 GLuint mcStitchProgram, GLuint triSSBO, GLuint edgeSSBO, GpuBufferPool* pool,
+                 int terrainMode = Config::TERRAIN_MODE, uint32_t batch = Config::EDIT_REMESH_BATCH);
+
+    EditRemesher(const EditRemesher&) = delete;
+    EditRemesher& operator=(const EditRemesher&) = delete;
+
+    // meshes[i] for requests[i]
+    void remesh(TerrainEdits& edits, const std::vector<Request>& requests, std::vector<Mesh>& meshes);
+
+    const Stats& stats() const { return counters; }
+
+    // deletes every buffer; needs the context
+    void destroy();
+
+private:
+    // the bricks written since the last call into deltaSSBO, all of them
+    // when it had to grow
+    void syncBricks(TerrainEdits& edits);
+    // at most batch requests: one density buffer each
+    void remeshSlice(const TerrainEdits& edits, const Request* requests, size_t n, Mesh* meshes);
+
+    GLuint densityProg = 0;
+    GLuint mcCountProg = 0;
+    GLuint mcEmitProg = 0;
+    GLuint mcStitchProg = 0;
+    GLuint triSSBO = 0;
+    GLuint edgeSSBO = 0;
+    GpuBufferPool* buffers = nullptr;
+    int terrainMode = 0;
+    uint32_t batch = 0;
+    HeightCache heightCache; // batch columns, flushed per slice
+
+    GLuint deltaSSBO = 0;
+    size_t deltaCapacity = 0; // bricks
+    std::vector<uint32_t> dirtyBricks;
+    GLuint sampledSSBO = 0;     // the coarser chunks' bricks of a slice
+    size_t sampledCapacity = 0; // bricks
+    std::vector<float> sampled;
+
+    // per chunk of a slice: brick table, density grid, offsets and totals
+    // (one aligned slot each)
+    GLuint tableSSBO = 0;
+    std::vector<uint32_t> tables;
+    std::vector<GLuint> densitySSBOs;
+    std::vector<GLuint> offsetSSBOs;
+    GLuint counterSSBO = 0;
+    GLsizeiptr counterStride = 0;
+    std::vector<GLuint> totals;
+
+    Stats counters;
+};
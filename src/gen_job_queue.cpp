@@ -0,0 +1,113 @@
+#include "gen_job_queue.h"
+#include "config.h"
+
+#include <algorithm>
+
+float GenJobQueue::score(const GenJob& job) const {
+    glm::vec3 center = job.worldPos + 0.5f * lod_scale(job.key.lod) * glm::vec3(Config::CHUNK_WIDTH, Config::CHUNK_HEIGHT, Config::CHUNK_DEPTH);
+    glm::vec3 d = center - focusPos;
+    float dist = glm::length(d);
+    if (dist < 1e-3f) {
+        return 0.0f;
+    }
+
+    // 1 straight ahead, -1 straight behind
+    float alignment = glm::dot(d / dist, focusDir);
+    return dist * (1.0f + Config::GEN_VIEW_BIAS * 0.5f * (1.0f - alignment));
+}
+
+void GenJobQueue::push(GenJob job) {
+    std::lock_guard<std::mutex> lk(m);
+    if (closed) {
+        return;
+    }
+    uint64_t seq = nextSeq++;
+    live[key64(job.key)] = seq;
+    heap.push_back(Entry{ score(job), seq, job });
+    std::push_heap(heap.begin(), heap.end(), Later{});
+    counters.pushed++;
+    cv.notify_one();
+}
+
+bool GenJobQueue::popLive(GenJob& out) {
+    while (!live.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), Later{});
+        Entry e = std::move(heap.back());
+        heap.pop_back();
+
+        auto it = live.find(key64(e.job.key));
+        if (it == live.end() || it->second != e.seq) {
+            continue; // cancelled or re-pushed since
+        }
+        live.erase(it);
+        counters.popped++;
+        out = e.job;
+        return true;
+    }
+    return false;
+}
+
+std::optional<GenJob> GenJobQueue::pop() {
+    std::unique_lock<std::mutex> lk(m);
+    cv.wait(lk, [&]{ return closed || !live.empty(); });
+    GenJob job;
+    if (!popLive(job)) {
+        return std::nullopt;
+    }
+    return job;
+}
+
+size_t GenJobQueue::popBatch(GenJob* out, size_t max) {
+    std::unique_lock<std::mutex> lk(m);
+    cv.wait(lk, [&]{ return closed || !live.empty(); });
+    size_t n = 0;
+    while (n < max && popLive(out[n])) {
+        n++;
+    }
+    return n;
+}
+
+void GenJobQueue::close() {
+    std::lock_guard<std::mutex> lk(m);
+    closed = true;
+    cv.notify_all();
+}
+
+bool GenJobQueue::cancel(const ChunkKey& key) {
+    std::lock_guard<std::mutex> lk(m);
+    if (live.erase(key64(key)) == 0) {
+        return false;
+    }
+    counters.cancelled++;
+    return true;
+}
+
+void GenJobQueue::setFocus(const glm::vec3& position, const glm::vec3& viewDir) {
+    std::lock_guard<std::mutex> lk(m);
+    focusPos = position;
+    float len = glm::length(viewDir);
+    focusDir = len > 0.0f ? viewDir / len : glm::vec3(0.0f, 0.0f, -1.0f);
+
+    // drop dead entries while rescoring
+    size_t w = 0;
+    for (size_t i = 0; i < heap.size(); ++i) {
+        auto it = live.find(key64(heap[i].job.key));
+        if (it == live.end() || it->second != heap[i].seq) continue;
+        heap[i].score = score(heap[i].job);
+        if (w != i) heap[w] = std::move(heap[i]);
+        w++;
+    }
+    heap.erase(heap.begin() + w, heap.end());
+    std::make_heap(heap.begin(), heap.end(), Later{});
+    counters.reprioritized++;
+}
+
+size_t GenJobQueue::size() {
+    std::lock_guard<std::mutex> lk(m);
+    return live.size();
+}
+
+GenJobQueue::Stats GenJobQueue::stats() {
+    std::lock_guard<std::mutex> lk(m);
+    return counters;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "worker_types.h"
+
+// blocking job queue for chunk generation that hands out the most urgent job
+// first instead of fifo. urgency is distance from the focus point (the player)
+// scaled up for chunks away from the view direction. pending jobs can be
+// cancelled by key, and setFocus() re-sorts everything still queued.
+class GenJobQueue {
+public:
+    struct Stats {
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        uint64_t cancelled = 0;
+        uint64_t reprioritized = 0; // setFocus() calls
+    };
+
+    void push(GenJob job);
+    std::optional<GenJob> pop();
+    // waits for a job, then takes up to max of the most urgent ones without
+    // waiting for more; 0 once closed and drained
+    size_t popBatch(GenJob* out, size_t max);
+    void close();
+
+    // drops the pending job for key; false if it was already handed out
+    bool cancel(const ChunkKey& key);
+
+    // moves the focus and re-sorts every pending job around it
+    void setFocus(const glm::vec3& position, const glm::vec3& viewDir);
+
+    size_t size();
+    Stats stats();
+
+private:
+    struct Entry {
+        float score;  // lower runs sooner
+        uint64_t seq; // matches live[key] while the job is still wanted
+        GenJob job;
+    };
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.score > b.score || (a.score == b.score && a.seq > b.seq);
+        }
+    };
+
+    float score(const GenJob& job) const;
+    // next live job off the heap, dropping dead entries; needs m held
+    bool popLive(GenJob& out);
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<Entry> heap;
+    // key64 -> seq of the entry that is still live; cancelled or superseded
+    // entries stay in the heap until they surface and are skipped
+    std::unordered_map<long long, uint64_t> live;
+    uint64_t nextSeq = 0;
+    bool closed = false;
+
+    glm::vec3 focusPos{0.0f};
+    glm::vec3 focusDir{0.0f, 0.0f, -1.0f};
+
+    Stats counters;
+};
@@ -0,0 +1,199 @@
+#include "gpu_buffer_pool.h"
+#include "config.h"
+
+#include <algorithm>
+#include <iterator>
+#include <glm/glm.hpp>
+
+namespace {
+    constexpr GLsizeiptr NUM_POINTS = GLsizeiptr(Config::CHUNK_WIDTH + 1) * (Config::CHUNK_HEIGHT + 1) * (Config::CHUNK_DEPTH + 1);
+    // 8^3 workgroups over the density points (mc_count / mc_emit)
+    constexpr GLsizeiptr NUM_POINT_GROUPS = GLsizeiptr((Config::CHUNK_WIDTH + 8) / 8) * ((Config::CHUNK_HEIGHT + 8) / 8) * ((Config::CHUNK_DEPTH + 8) / 8);
+
+    // vertex ranges are handed out in multiples of this many vertices
+    constexpr uint32_t VERTEX_GRANULE = 96;
+
+    constexpr GLsizeiptr VERTEX_BYTES = sizeof(glm::uvec2);
+
+    uint32_t round_to_granule(uint32_t count) {
+        return (count + VERTEX_GRANULE - 1) / VERTEX_GRANULE * VERTEX_GRANULE;
+    }
+}
+
+GLsizeiptr GpuBufferPool::kindSize(Kind kind) {
+    switch (kind) {
+        case Kind::Density:  return NUM_POINTS * sizeof(float);
+        case Kind::Offsets:  return NUM_POINTS * 2 * sizeof(GLuint); // first vertex, first index
+        case Kind::Counter:  return 2 * sizeof(GLuint);                // vertex, index totals
+        case Kind::Groups:   return NUM_POINT_GROUPS * sizeof(GLuint);   // solid / air / surface
+        default:             return 0;
+    }
+}
+
+GLuint GpuBufferPool::acquire(Kind kind) {
+    std::lock_guard<std::mutex> lk(m);
+    auto& list = freeLists[size_t(kind)];
+    if (!list.empty()) {
+        GLuint buffer = list.back();
+        list.pop_back();
+        counters.scratchReused++;
+        return buffer;
+    }
+
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, kindSize(kind), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    allScratch.push_back(buffer);
+    counters.scratchCreated++;
+    return buffer;
+}
+
+void GpuBufferPool::release(Kind kind, GLuint buffer) {
+    if (!buffer) return;
+    std::lock_guard<std::mutex> lk(m);
+    freeLists[size_t(kind)].push_back(buffer);
+}
+
+VertexRange GpuBufferPool::allocVertices(uint32_t count) {
+    if (count == 0) return {};
+    uint32_t want = round_to_granule(count);
+
+    {
+        std::lock_guard<std::mutex> lk(m);
+        for (uint32_t s = 0; s < uint32_t(slabs.size()); ++s) {
+            auto& freeRanges = slabs[s].free;
+            for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+                if (it->second < want) continue;
+                uint32_t first = it->first;
+                uint32_t left = it->second - want;
+                freeRanges.erase(it);
+                if (left) {
+                    freeRanges.emplace(first + want, left);
+                }
+                counters.vertexAllocs++;
+                counters.vertexBytesInUse += uint64_t(want) * VERTEX_BYTES;
+                return VertexRange{ slabs[s].buffer, s, first, want };
+            }
+        }
+    }
+
+    // no room: new slab, oversized if a single chunk needs more than a slab.
+    // created and finished without the lock so the other thread's frees and
+    // allocations never wait on this context's queue; if both threads get
+    // here at once, both slabs are kept
+    Slab slab;
+    slab.capacity = std::max<uint32_t>(Config::VERTEX_SLAB_VERTICES, want);
+    glGenBuffers(1, &slab.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slab.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(slab.capacity) * VERTEX_BYTES, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    // rare; make the storage visible to the other context before anyone uses it
+    glFinish();
+    if (slab.capacity > want) {
+        slab.free.emplace(want, slab.capacity - want);
+    }
+
+    std::lock_guard<std::mutex> lk(m);
+    slabs.push_back(std::move(slab));
+    counters.slabsCreated++;
+    counters.slabBytes += uint64_t(slabs.back().capacity) * VERTEX_BYTES;
+    counters.vertexAllocs++;
+    counters.vertexBytesInUse += uint64_t(want) * VERTEX_BYTES;
+    return VertexRange{ slabs.back().buffer, uint32_t(slabs.size() - 1), 0, want };
+}
+
+VertexRange GpuBufferPool::shrinkVertices(const VertexRange& range, uint32_t count) {
+    uint32_t keep = round_to_granule(count);
+    if (count == 0 || keep >= range.count) return range;
+
+    std::lock_guard<std::mutex> lk(m);
+    insertFree(slabs[range.slab], range.first + keep, range.count - keep);
+    counters.vertexBytesInUse -= uint64_t(range.count - keep) * VERTEX_BYTES;
+
+    VertexRange kept = range;
+    kept.count = keep;
+    return kept;
+}
+
+void GpuBufferPool::freeVertices(const VertexRange& range) {
+    if (range.count == 0) return;
+    std::lock_guard<std::mutex> lk(m);
+    freedThisFrame.push_back(range);
+}
+
+void GpuBufferPool::endFrame() {
+    std::lock_guard<std::mutex> lk(m);
+    if (!freedThisFrame.empty()) {
+        Retiring r;
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        r.ranges.swap(freedThisFrame);
+        retiring.push_back(std::move(r));
+    }
+
+    // fences signal in order; stop at the first frame still in flight
+    while (!retiring.empty()) {
+        GLenum status = glClientWaitSync(retiring.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(retiring.front().fence);
+        for (const auto& range : retiring.front().ranges) {
+            returnRange(range);
+        }
+        retiring.pop_front();
+    }
+}
+
+void GpuBufferPool::returnRange(const VertexRange& range) {
+    insertFree(slabs[range.slab], range.first, range.count);
+    counters.vertexFrees++;
+    counters.vertexBytesInUse -= uint64_t(range.count) * VERTEX_BYTES;
+}
+
+void GpuBufferPool::insertFree(Slab& slab, uint32_t first, uint32_t count) {
+    auto& freeRanges = slab.free;
+
+    // merge with the neighbours on either side
+    auto next = freeRanges.lower_bound(first);
+    if (next != freeRanges.end() && first + count == next->first) {
+        count += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == first) {
+            prev->second += count;
+            count = 0;
+        }
+    }
+    if (count) {
+        freeRanges.emplace(first, count);
+    }
+}
+
+GpuBufferPool::Stats GpuBufferPool::stats() {
+    std::lock_guard<std::mutex> lk(m);
+    return counters;
+}
+
+void GpuBufferPool::destroy() {
+    std::lock_guard<std::mutex> lk(m);
+    for (auto& r : retiring) {
+        glDeleteSync(r.fence);
+    }
+    retiring.clear();
+    freedThisFrame.clear();
+
+    if (!allScratch.empty()) {
+        glDeleteBuffers(GLsizei(allScratch.size()), allScratch.data());
+    }
+    allScratch.clear();
+    for (auto& list : freeLists) {
+        list.clear();
+    }
+
+    for (auto& slab : slabs) {
+        glDeleteBuffers(1, &slab.buffer);
+    }
+    slabs.clear();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+
+// slab slots (uvec2) a chunk mesh takes: its vertices, then its 32-bit
+// indices two to a slot
+inline uint32_t mesh_slots(uint32_t vertexCount, uint32_t indexCount) {
+    return vertexCount + (indexCount + 1) / 2;
+}
+
+// a chunk's mesh inside one of the pool's vertex slabs
+struct VertexRange {
+    GLuint buffer = 0;  // slab buffer object
+    uint32_t slab = 0;
+    uint32_t first = 0; // in vertices (uvec2)
+    uint32_t count = 0; // reserved vertices, >= the chunk's vertex count
+};
+
+// keeps chunk generation off the driver's allocator. fixed-size scratch
+// buffers (density, offsets, counter, group states) are recycled through
+// free lists, and vertex storage is carved out of a few large slabs with a
+// first-fit free list per slab. shared by the worker and main contexts; every
+// call locks, but never while waiting on the gpu (a new slab is created and
+// finished outside the lock). buffers are only ever deleted by destroy().
+class GpuBufferPool {
+public:
+    enum class Kind { Density, Offsets, Counter, Groups, COUNT };
+
+    struct Stats {
+        uint64_t scratchCreated = 0; // glBufferData calls for scratch buffers
+        uint64_t scratchReused = 0;
+        uint64_t slabsCreated = 0;
+        uint64_t vertexAllocs = 0;
+        uint64_t vertexFrees = 0;
+        uint64_t vertexBytesInUse = 0;
+        uint64_t slabBytes = 0;
+    };
+
+    GpuBufferPool() = default;
+    GpuBufferPool(const GpuBufferPool&) = delete;
+    GpuBufferPool& operator=(const GpuBufferPool&) = delete;
+
+    // buffer of the kind's fixed size; contents are undefined
+    GLuint acquire(Kind kind);
+    // caller guarantees the gpu no longer uses it (fence waited)
+    void release(Kind kind, GLuint buffer);
+
+    // reserves room for count vertices, adding a slab if none has space
+    VertexRange allocVertices(uint32_t count);
+    // trims range to count vertices and frees the tail at once; only for ranges
+    // that were never drawn and whose gpu writes have completed
+    VertexRange shrinkVertices(const VertexRange& range, uint32_t count);
+    // the range may still be read by draws in flight; it is reused only after
+    // the fence of the next endFrame() signals
+    void freeVertices(const VertexRange& range);
+
+    // main thread, once per frame after the draws were issued
+    void endFrame();
+
+    Stats stats();
+
+    // deletes every buffer and fence; needs a current context
+    void destroy();
+
+private:
+    struct Slab {
+        GLuint buffer = 0;
+        uint32_t capacity = 0;               // vertices
+        std::map<uint32_t, uint32_t> free;   // first -> count, coalesced
+    };
+    struct Retiring {
+        GLsync fence = 0;
+        std::vector<VertexRange> ranges;
+    };
+
+    static GLsizeiptr kindSize(Kind kind);
+    void returnRange(const VertexRange& range);
+    void insertFree(Slab& slab, uint32_t first, uint32_t count);
+
+    std::mutex m;
+    std::vector<GLuint> freeLists[size_t(Kind::COUNT)];
+    std::vector<GLuint> allScratch;
+    std::vector<Slab> slabs;
+    std::vector<VertexRange> freedThisFrame;
+    std::deque<Retiring> retiring;
+    Stats counters;
+};
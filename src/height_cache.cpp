@@ -0,0 +1,72 @@
+#include "height_cache.h"
+
+namespace {
+    constexpr GLuint COLUMN_POINTS = Config::CHUNK_WIDTH + 1;
+    constexpr GLuint COLUMN_GROUPS = (COLUMN_POINTS + 7) / 8; // local_size of heights.comp
+}
+
+HeightCache::HeightCache(GLuint heightsProgram, uint32_t columns)
+    : heightsProg(heightsProgram), capacity(columns) {}
+
+uint32_t HeightCache::column(const ChunkKey& key, const glm::vec3& worldPos) {
+    const long long k = key64(key.x, 0, key.z, key.lod);
+    auto it = entries.find(k);
+    if (it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru);
+        counters.hits++;
+        return it->second.slot * COLUMN_POINTS * COLUMN_POINTS;
+    }
+    counters.misses++;
+
+    uint32_t slot = uint32_t(entries.size());
+    if (entries.size() == capacity) {
+        // earlier passes reading the evicted slot are ordered before the
+        // overwrite: same context, and every pass ends with a barrier
+        auto victim = entries.find(lru.back());
+        slot = victim->second.slot;
+        entries.erase(victim);
+        lru.pop_back();
+    }
+    lru.push_front(k);
+    entries[k] = Entry{ slot, lru.begin() };
+
+    BatchChunk fill;
+    fill.worldPos = glm::vec4(worldPos, lod_scale(key.lod));
+    fill.heightBase = slot * COLUMN_POINTS * COLUMN_POINTS;
+    pending.push_back(fill);
+    return fill.heightBase;
+}
+
+void HeightCache::flush() {
+    if (pending.empty()) return;
+
+    if (heights == 0) {
+        glGenBuffers(1, &heights);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, heights);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(capacity) * COLUMN_POINTS * COLUMN_POINTS * sizeof(float),
+                     nullptr, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &fillBatch);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, fillBatch);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(capacity) * sizeof(BatchChunk), nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, fillBatch);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(pending.size() * sizeof(BatchChunk)), pending.data());
+
+    glUseProgram(heightsProg);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, heights);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, fillBatch);
+    glDispatchCompute(COLUMN_GROUPS, COLUMN_GROUPS, GLuint(pending.size()));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    pending.clear();
+}
+
+void HeightCache::destroy() {
+    glDeleteBuffers(1, &heights);
+    glDeleteBuffers(1, &fillBatch);
+    heights = 0;
+    fillBatch = 0;
+    entries.clear();
+    lru.clear();
+    pending.clear();
+}
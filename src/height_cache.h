@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "config.h"
+#include "worker_types.h"
+
+// terrainMode 1: the 2d heights of a column of chunks, (CHUNK_WIDTH + 1)^2 per
+// (x, z, lod), computed once by shaders/heights.comp and read by every chunk
+// stacked in that column (terrain.comp's column_height). a fixed number of
+// slots in one buffer, the least recently used column evicted first; misses
+// are filled together by flush(), so at most `columns` distinct columns may be
+// looked up between two flushes. worker thread only: the buffers are created
+// in, and need, its context
+class HeightCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // heightsProgram: shaders/heights.comp
+    explicit HeightCache(GLuint heightsProgram, uint32_t columns = Config::GPU_HEIGHT_CACHE_COLUMNS);
+
+    HeightCache(const HeightCache&) = delete;
+    HeightCache& operator=(const HeightCache&) = delete;
+
+    // first height of key's column in buffer() (terrain.comp's heightBase);
+    // a missing column is queued for flush(). worldPos is the chunk's, any y
+    uint32_t column(const ChunkKey& key, const glm::vec3& worldPos);
+
+    // fills the columns queued since the last flush, one heights.comp dispatch
+    // for all of them; call before the passes that read them
+    void flush();
+
+    // bound at binding 8 for the passes that read heights
+    GLuint buffer() const { return heights; }
+
+    const Stats& stats() const { return counters; }
+
+    void destroy();
+
+private:
+    struct Entry {
+        uint32_t slot = 0;
+        std::list<long long>::iterator lru;
+    };
+
+    GLuint heightsProg = 0;
+    uint32_t capacity = 0;
+    GLuint heights = 0;
+    GLuint fillBatch = 0; // BatchChunk per queued column (binding 10)
+    std::vector<BatchChunk> pending;
+    std::unordered_map<long long, Entry> entries;
+    std::list<long long> lru; // most recently used first
+    Stats counters;
+};
@@ -0,0 +1,103 @@
+#include "hiz_pyramid.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr GLuint GROUP_SIZE = 8; // local_size of hiz_build.comp
+
+    int mip_count(int w, int h) {
+        int levels = 1;
+        for (int s = std::max(w, h); s > 1; s >>= 1) {
+            levels++;
+        }
+        return levels;
+    }
+
+    GLuint groups(int texels) {
+        return (GLuint(texels) + GROUP_SIZE - 1) / GROUP_SIZE;
+    }
+}
+
+HiZPyramid::HiZPyramid(GLuint buildProgram) : buildProg(buildProgram) {}
+
+HiZPyramid::~HiZPyramid() {
+    glDeleteTextures(1, &depthCopy);
+    glDeleteTextures(1, &pyramid);
+}
+
+void HiZPyramid::resize(int w, int h) {
+    glDeleteTextures(1, &depthCopy);
+    glDeleteTextures(1, &pyramid);
+    width = w;
+    height = h;
+    levels = mip_count(w, h);
+    built = false;
+
+    glGenTextures(1, &depthCopy);
+    glBindTexture(GL_TEXTURE_2D, depthCopy);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, w, h);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenTextures(1, &pyramid);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, w, h);
+    // the cull pass picks the level itself; never blend depths
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void HiZPyramid::build(int w, int h, const glm::mat4& viewProj) {
+    if (w <= 0 || h <= 0) return; // minimized
+    if (w != width || h != height) {
+        resize(w, h);
+    }
+
+    GLint drawProgram = 0;
+    GLint activeUnit = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &drawProgram);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+
+    glBindTexture(GL_TEXTURE_2D, depthCopy);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, w, h);
+
+    glUseProgram(buildProg);
+    glUniform1i(glGetUniformLocation(buildProg, "src"), GLint(TEXTURE_UNIT));
+    GLint srcLevelLoc = glGetUniformLocation(buildProg, "srcLevel");
+    GLint srcSizeLoc = glGetUniformLocation(buildProg, "srcSize");
+    GLint dstSizeLoc = glGetUniformLocation(buildProg, "dstSize");
+
+    // level 0: depth texture -> r32f
+    glUniform1i(srcLevelLoc, -1);
+    glUniform2i(srcSizeLoc, w, h);
+    glUniform2i(dstSizeLoc, w, h);
+    glBindImageTexture(0, pyramid, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(groups(w), groups(h), 1);
+
+    // each further level reads the one above it from the same texture
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    int sw = w, sh = h;
+    for (int level = 1; level < levels; ++level) {
+        int dw = std::max(sw >> 1, 1);
+        int dh = std::max(sh >> 1, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        glUniform1i(srcLevelLoc, level - 1);
+        glUniform2i(srcSizeLoc, sw, sh);
+        glUniform2i(dstSizeLoc, dw, dh);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute(groups(dw), groups(dh), 1);
+        sw = dw;
+        sh = dh;
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    glActiveTexture(GLenum(activeUnit));
+    glUseProgram(GLuint(drawProgram));
+
+    builtViewProj = viewProj;
+    built = true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// hierarchical depth buffer for occlusion culling. level 0 is a copy of the
+// frame's depth buffer and every further level keeps the farthest depth of the
+// texels below it, so one fetch bounds the depth of a whole screen rect. built
+// after the terrain is drawn; the next frame's cull pass tests chunks against
+// it using the view-projection the depth was rendered with.
+class HiZPyramid {
+public:
+    // unit the pyramid is sampled from; unit 0 holds the terrain texture
+    static constexpr GLuint TEXTURE_UNIT = 1;
+
+    // buildProgram: shaders/hiz_build.comp
+    explicit HiZPyramid(GLuint buildProgram);
+    ~HiZPyramid();
+
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+    // copies the depth of the bound read framebuffer (width x height) and
+    // reduces it; restores the current program and active texture unit
+    void build(int width, int height, const glm::mat4& viewProj);
+
+    bool valid() const { return built; }
+    GLuint texture() const { return pyramid; }
+    const glm::mat4& viewProj() const { return builtViewProj; }
+    glm::vec2 size() const { return glm::vec2(float(width), float(height)); }
+    int levelCount() const { return levels; }
+
+private:
+    void resize(int w, int h);
+
+    GLuint buildProg = 0;
+    GLuint depthCopy = 0; // GL_DEPTH_COMPONENT24, copy target for the depth buffer
+    GLuint pyramid = 0;   // GL_R32F with the full mip chain
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    bool built = false;
+    glm::mat4 builtViewProj{ 1.0f };
+};
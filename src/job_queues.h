@@ -4,6 +4,11 @@
 #include <condition_variable>
 #include <queue>
 #include <optional>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
 
 template<typename T>
 class BlockingQueue {
@@ -37,22 +42,109 @@ public:
     }
 };
 
+// bounded single-producer/single-consumer ring. push and pop touch only
+// their own index plus a cached copy of the other side's, so neither side
+// takes a lock or allocates; capacity is rounded up to a power of two.
 template<typename T>
 class SPSCQueue {
-    std::mutex m;
-    std::queue<T> q;
+    static constexpr size_t CACHE_LINE = 64;
+
+    // consumer-owned
+    alignas(CACHE_LINE) std::atomic<size_t> head{0};
+    size_t tailCache = 0;
+    // producer-owned
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+    size_t headCache = 0;
+    // shared, read-only after construction
+    alignas(CACHE_LINE) std::unique_ptr<T[]> slots;
+    size_t mask = 0;
+
+    static size_t round_up_pow2(size_t n) {
+        size_t c = 1;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+    // producer: free slots, refreshing the cached head only when it looks full
+    size_t free_slots(size_t t) {
+        size_t cap = mask + 1;
+        if (t - headCache >= cap) {
+            headCache = head.load(std::memory_order_acquire);
+        }
+        return cap - (t - headCache);
+    }
+
+    // consumer: filled slots, refreshing the cached tail only when it looks empty
+    size_t filled_slots(size_t h) {
+        if (tailCache == h) {
+            tailCache = tail.load(std::memory_order_acquire);
+        }
+        return tailCache - h;
+    }
+
 public:
+    explicit SPSCQueue(size_t capacity = 1024)
+        : slots(new T[round_up_pow2(capacity < 2 ? 2 : capacity)]),
+          mask(round_up_pow2(capacity < 2 ? 2 : capacity) - 1) {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    // wait-free; returns false (and leaves v untouched) when full
+    bool try_push(T& v) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (free_slots(t) == 0) {
+            return false;
+        }
+        slots[t & mask] = std::move(v);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // never drops: yields while the consumer catches up
     void push(T v) {
-        std::lock_guard<std::mutex> lk(m);
-        q.push(std::move(v));
+        while (!try_push(v)) {
+            std::this_thread::yield();
+        }
+    }
+
+    // moves up to n items from items[], publishes them with one store and
+    // returns how many fit
+    size_t push_batch(T* items, size_t n) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t count = std::min(n, free_slots(t));
+        for (size_t i = 0; i < count; ++i) {
+            slots[(t + i) & mask] = std::move(items[i]);
+        }
+        if (count) {
+            tail.store(t + count, std::memory_order_release);
+        }
+        return count;
     }
+
+    // wait-free
     bool try_pop(T& out) {
-        std::lock_guard<std::mutex> lk(m);
-        if (q.empty()) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (filled_slots(h) == 0) {
             return false;
         }
-        out = std::move(q.front());
-        q.pop();
+        out = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
         return true;
     }
+
+    // moves up to max items into out[] and releases their slots with one store
+    size_t pop_batch(T* out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t count = std::min(max, filled_slots(h));
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = std::move(slots[(h + i) & mask]);
+        }
+        if (count) {
+            head.store(h + count, std::memory_order_release);
+        }
+        return count;
+    }
 };
@@ -57,10 +57,24 @@ unsigned int generate_compute_program(const char* computePath) {
 
 // computer shader with include file
 unsigned int generate_compute_program(const char* includePath, const char* computePath) {
-    std::string includeShaderCode = read_file(includePath);
+    return generate_compute_program({ includePath }, computePath);
+}
+
+// compute shader after several include files, in order. the combined source
+// gets one #version line; the compute file may carry its own
+unsigned int generate_compute_program(std::initializer_list<const char*> includePaths, const char* computePath) {
+    std::string combinedCode = "#version 430 core\n";
+    std::string name;
+    for (const char* includePath : includePaths) {
+        combinedCode += read_file(includePath) + "\n";
+        name += std::string(includePath) + " + ";
+    }
     std::string computeShaderCode = read_file(computePath);
-    std::string combinedCode = "#version 430 core\n" + includeShaderCode + "\n" + computeShaderCode;
-    return compile_compute_shader(combinedCode, std::string(includePath) + " + " + computePath);
+    if (computeShaderCode.rfind("#version", 0) == 0) {
+        computeShaderCode.erase(0, computeShaderCode.find('\n'));
+    }
+    combinedCode += computeShaderCode;
+    return compile_compute_shader(combinedCode, name + computePath);
 }
 
 // vertex and fragment shader compile
@@ -23,10 +23,12 @@ inline GLUniforms get_locations(GLuint prog) {
 #pragma once
 
 #include <glad/glad.h>
+#include <initializer_list>
 #include <string>
 
 unsigned int compile_compute_shader(const std::string& shaderCode, const std::string& name);
 unsigned int generate_compute_program(const char* computePath);
 unsigned int generate_compute_program(const char* includePath, const char* computePath);
+unsigned int generate_compute_program(std::initializer_list<const char*> includePaths, const char* computePath);
 unsigned int compile_shader(GLenum shaderType, const std::string& source, const std::string& typeName);
 unsigned int generate_shader_program();
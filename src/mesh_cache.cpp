@@ -0,0 +1,266 @@
+#include "mesh_cache.h"
+#include "terrain.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // bump when the meshes change for the same parameters (mesher, vertex packing)
+    constexpr uint32_t FORMAT_VERSION = 2;
+    constexpr char MAGIC[4] = { 'T', 'M', 'C', 'R' };
+    constexpr int REGION = Config::MESH_CACHE_REGION;
+    constexpr size_t RECORDS = size_t(REGION) * REGION * REGION;
+    // files grow in steps of this much, each step a remap
+    constexpr size_t GROW_BYTES = size_t(4) << 20;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t params; // param_hash() of the writer
+        uint64_t end;    // first free byte
+    };
+
+    struct Record {
+        uint64_t offset;
+        uint32_t capacity; // bytes reserved at offset
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint8_t present;
+        uint8_t seams;
+        uint16_t pad;
+    };
+    static_assert(sizeof(Header) == 24 && sizeof(Record) == 24, "fixed on-disk layout");
+
+    constexpr size_t TABLE_END = sizeof(Header) + RECORDS * sizeof(Record);
+
+    // fnv-1a over everything the meshes depend on
+    uint64_t param_hash() {
+        const float params[] = {
+            float(Config::CHUNK_WIDTH), float(Config::CHUNK_HEIGHT), float(Config::CHUNK_DEPTH),
+            float(Config::TERRAIN_MODE), Config::ISOLEVEL,
+            Terrain::DENSITY_EXP, Terrain::FLOOR_OFFSET,
+            float(Terrain::OCTAVES_3D), Terrain::BASE_FREQUENCY_3D, Terrain::BASE_AMPLITUDE_3D,
+            Terrain::LACUNARITY_3D, Terrain::PERSISTENCE_3D, Terrain::NOISE_WEIGHT_3D,
+            float(Terrain::OCTAVES_2D), Terrain::BASE_FREQUENCY_2D, Terrain::BASE_AMPLITUDE_2D,
+            Terrain::LACUNARITY_2D, Terrain::PERSISTENCE_2D, Terrain::NOISE_WEIGHT_2D,
+        };
+        uint64_t h = 0xcbf29ce484222325ull;
+        auto mix = [&](const void* p, size_t n) {
+            const uint8_t* b = static_cast<const uint8_t*>(p);
+            for (size_t i = 0; i < n; ++i) {
+                h = (h ^ b[i]) * 0x100000001b3ull;
+            }
+        };
+        mix(&FORMAT_VERSION, sizeof(FORMAT_VERSION));
+        mix(params, sizeof(params));
+        return h;
+    }
+
+    int floor_div(int v) {
+        return (v >= 0 ? v : v - (REGION - 1)) / REGION;
+    }
+
+    long long region_key(const ChunkKey& k) {
+        return key64(floor_div(k.x), floor_div(k.y), floor_div(k.z), k.lod);
+    }
+
+    size_t record_index(const ChunkKey& k) {
+        int x = k.x - floor_div(k.x) * REGION;
+        int y = k.y - floor_div(k.y) * REGION;
+        int z = k.z - floor_div(k.z) * REGION;
+        return (size_t(z) * REGION + size_t(y)) * REGION + size_t(x);
+    }
+
+    Header* header(uint8_t* map) {
+        return reinterpret_cast<Header*>(map);
+    }
+
+    Record* record(uint8_t* map, const ChunkKey& k) {
+        return reinterpret_cast<Record*>(map + sizeof(Header)) + record_index(k);
+    }
+
+    // whether rec's extent lies in the file's data and holds its mesh; the
+    // table is trusted no further than the header (torn writes, foreign
+    // tools), a failing record is treated as absent
+    bool record_fits(const Header* h, const Record* rec) {
+        // mesh_slots in 64 bits, so garbage counts cannot wrap
+        const uint64_t bytes = (uint64_t(rec->vertexCount) + (uint64_t(rec->indexCount) + 1) / 2) * sizeof(glm::uvec2);
+        return rec->offset >= TABLE_END && rec->offset <= h->end && rec->capacity <= h->end - rec->offset
+            && bytes <= rec->capacity;
+    }
+
+    uint8_t* map_file(int fd, size_t bytes) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+    }
+}
+
+MeshCache::MeshCache(std::string directory, uint32_t maxOpenRegions)
+    : dir(std::move(directory)), maxOpen(maxOpenRegions < 1 ? 1 : maxOpenRegions) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec); // on failure every store just misses
+}
+
+MeshCache::~MeshCache() {
+    for (auto& [key, r] : regions) {
+        close(r);
+    }
+}
+
+std::string MeshCache::path(const ChunkKey& key) const {
+    return dir + "/r." + std::to_string(key.lod) + "." + std::to_string(floor_div(key.x)) + "."
+         + std::to_string(floor_div(key.y)) + "." + std::to_string(floor_div(key.z)) + ".mesh";
+}
+
+void MeshCache::close(Region& r) {
+    if (r.map) {
+        munmap(r.map, r.mapped);
+    }
+    if (r.fd >= 0) {
+        ::close(r.fd);
+    }
+    r.map = nullptr;
+    r.mapped = 0;
+    r.fd = -1;
+}
+
+MeshCache::Region* MeshCache::open(const ChunkKey& key, bool create) {
+    const long long rk = region_key(key);
+    auto it = regions.find(rk);
+    if (it != regions.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru);
+        if (it->second.map || !create) {
+            return it->second.map ? &it->second : nullptr;
+        }
+    } else {
+        if (regions.size() >= maxOpen) {
+            auto victim = regions.find(lru.back());
+            close(victim->second);
+            regions.erase(victim);
+            lru.pop_back();
+        }
+        lru.push_front(rk);
+        it = regions.emplace(rk, Region{}).first;
+        it->second.lru = lru.begin();
+    }
+
+    Region& r = it->second;
+    if (r.fd < 0) {
+        r.fd = ::open(path(key).c_str(), O_RDWR | (create ? O_CREAT : 0), 0644);
+        if (r.fd < 0) {
+            return nullptr; // stays known as absent until a store creates it
+        }
+    }
+
+    // a missing, short or foreign file is (re)initialised on the first store only
+    struct stat st;
+    bool valid = fstat(r.fd, &st) == 0 && size_t(st.st_size) >= TABLE_END;
+    if (valid) {
+        r.mapped = size_t(st.st_size);
+        r.map = map_file(r.fd, r.mapped);
+        const Header* h = r.map ? header(r.map) : nullptr;
+        valid = h && std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == FORMAT_VERSION
+             && h->params == param_hash() && h->end >= TABLE_END && h->end <= r.mapped;
+        if (!valid && r.map) {
+            munmap(r.map, r.mapped);
+            r.map = nullptr;
+        }
+    }
+    if (!valid) {
+        if (!create) {
+            return nullptr;
+        }
+        r.mapped = TABLE_END + GROW_BYTES;
+        if (ftruncate(r.fd, 0) != 0 || ftruncate(r.fd, off_t(r.mapped)) != 0
+            || !(r.map = map_file(r.fd, r.mapped))) {
+            close(r);
+            return nullptr;
+        }
+        Header* h = header(r.map); // the table is zero: no records
+        std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+        h->version = FORMAT_VERSION;
+        h->params = param_hash();
+        h->end = TABLE_END;
+    }
+    counters.regionsOpened++;
+    return &r;
+}
+
+bool MeshCache::grow(Region& r, size_t bytes) {
+    size_t size = std::max(bytes, r.mapped + GROW_BYTES);
+    munmap(r.map, r.mapped);
+    r.map = nullptr;
+    if (ftruncate(r.fd, off_t(size)) != 0 || !(r.map = map_file(r.fd, size))) {
+        close(r);
+        return false;
+    }
+    r.mapped = size;
+    return true;
+}
+
+bool MeshCache::find(const ChunkKey& key, uint8_t seams, Mesh& out) {
+    Region* r = open(key, false);
+    Record* rec = r ? record(r->map, key) : nullptr;
+    if (rec && rec->present && !record_fits(header(r->map), rec)) {
+        *rec = Record{};
+        rec = nullptr;
+    }
+    if (!rec || !rec->present || rec->seams != seams) {
+        counters.misses++;
+        return false;
+    }
+    out.data = r->map + rec->offset;
+    out.vertexCount = rec->vertexCount;
+    out.indexCount = rec->indexCount;
+    counters.hits++;
+    counters.bytesRead += size_t(mesh_slots(rec->vertexCount, rec->indexCount)) * sizeof(glm::uvec2);
+    return true;
+}
+
+void MeshCache::store(const ChunkKey& key, uint8_t seams, const glm::uvec2* vertices, uint32_t vertexCount,
+                      const uint32_t* indices, uint32_t indexCount) {
+    Region* r = open(key, true);
+    if (!r) return;
+
+    const size_t vertexBytes = indexCount ? size_t(vertexCount) * sizeof(glm::uvec2) : 0;
+    const size_t bytes = indexCount ? size_t(mesh_slots(vertexCount, indexCount)) * sizeof(glm::uvec2) : 0;
+    Record* rec = record(r->map, key);
+    rec->present = 0; // not a valid record again until the mesh is in place
+    rec->vertexCount = 0;
+    rec->indexCount = 0;
+    if (!record_fits(header(r->map), rec)) {
+        // never written, or not to be trusted: an empty extent at the end
+        rec->offset = header(r->map)->end;
+        rec->capacity = 0;
+    }
+    uint64_t offset = rec->offset;
+    if (bytes > rec->capacity) {
+        offset = header(r->map)->end;
+        if (offset + bytes > r->mapped && !grow(*r, offset + bytes)) return;
+        header(r->map)->end = offset + bytes;
+        rec = record(r->map, key); // remapped
+        rec->offset = offset;
+        rec->capacity = uint32_t(bytes);
+    }
+
+    if (bytes) {
+        std::memcpy(r->map + offset, vertices, vertexBytes);
+        std::memcpy(r->map + offset + vertexBytes, indices, size_t(indexCount) * sizeof(uint32_t));
+    }
+    rec->vertexCount = indexCount ? vertexCount : 0;
+    rec->indexCount = indexCount;
+    rec->seams = seams;
+    rec->present = 1;
+    counters.stores++;
+    counters.bytesWritten += bytes;
+}
+
+void MeshCache::erase(const ChunkKey& key) {
+    if (Region* r = open(key, false)) {
+        record(r->map, key)->present = 0;
+    }
+}
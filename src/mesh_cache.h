@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "config.h"
+#include "worker_types.h"
+
+// finished chunk meshes on disk, for chunks requested again after World
+// dropped them and across runs. one region file per MESH_CACHE_REGION^3
+// chunks of a lod: a header, a fixed table with one record per chunk, then the
+// meshes in the slab layout (packed uvec2 vertices, then uint32 indices, see
+// mesh_slots), so a hit is uploaded straight from the file's mapping. files
+// written with other chunk, terrain or mesher parameters are discarded on
+// open. posix mmap; main thread only
+class MeshCache {
+public:
+    struct Mesh {
+        const void* data = nullptr; // mesh_slots(vertexCount, indexCount) uvec2 slots
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;    // 0: the chunk has no surface
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t bytesRead = 0;    // mesh bytes handed out by hits
+        uint64_t bytesWritten = 0;
+        uint64_t regionsOpened = 0;
+    };
+
+    explicit MeshCache(std::string directory = Config::MESH_CACHE_DIR,
+                       uint32_t maxOpenRegions = Config::MESH_CACHE_OPEN_REGIONS);
+    ~MeshCache();
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    // the mesh stored for key, if it was built with the same seam mask (see
+    // GenJob::seams). data points into the mapping and stays valid until the
+    // next call. a record whose extent does not fit the file is cleared and
+    // reported as a miss
+    bool find(const ChunkKey& key, uint8_t seams, Mesh& out);
+
+    // records key's mesh, replacing the previous one; indices may be null when
+    // there are none. a record that outgrows its space, or whose space does
+    // not fit the file, is moved to the end of the file; the old space is not
+    // reused
+    void store(const ChunkKey& key, uint8_t seams, const glm::uvec2* vertices, uint32_t vertexCount,
+               const uint32_t* indices, uint32_t indexCount);
+
+    // forgets key's mesh, e.g. after its terrain changed
+    void erase(const ChunkKey& key);
+
+    const Stats& stats() const { return counters; }
+
+private:
+    struct Region {
+        int fd = -1;
+        uint8_t* map = nullptr; // nullptr: no valid file yet
+        size_t mapped = 0;      // bytes, the file's size
+        std::list<long long>::iterator lru;
+    };
+
+    // key's region, opened and mapped on first use; nullptr when it has no
+    // valid file and create is false, or the file cannot be created
+    Region* open(const ChunkKey& key, bool create);
+    bool grow(Region& r, size_t bytes);
+    void close(Region& r);
+    std::string path(const ChunkKey& key) const;
+
+    std::string dir;
+    uint32_t maxOpen = 0;
+    std::unordered_map<long long, Region> regions;
+    std::list<long long> lru; // most recently used first
+    Stats counters;
+};
@@ -0,0 +1,222 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <string>
+
+namespace {
+    // the frame track first, then a cpu and a gpu track per thread
+    constexpr int FRAME_TID = 0;
+    // query sets per thread to begin with; a frame or worker loop each, as
+    // many as the gpu runs behind
+    constexpr size_t QUERY_SETS = 4;
+
+    void write_json_string(std::ostream& out, const char* s) {
+        out << '"';
+        for (; *s; ++s) {
+            const unsigned char c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\') {
+                out << '\\' << char(c);
+            } else if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out << buf;
+            } else {
+                out << char(c);
+            }
+        }
+        out << '"';
+    }
+
+    // a complete ("X") event; chrome trace times are microseconds
+    void write_complete(std::ostream& out, const char* name, const char* category, int tid,
+                        uint64_t startNs, uint64_t durationNs, uint32_t frame) {
+        char times[96];
+        std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", startNs / 1e3, durationNs / 1e3);
+        out << "{\"name\":";
+        write_json_string(out, name);
+        out << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ',' << times
+            << ",\"args\":{\"frame\":" << frame << "}}";
+    }
+
+    void write_thread_name(std::ostream& out, int tid, const std::string& name) {
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        write_json_string(out, name.c_str());
+        out << "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"sort_index\":" << tid << "}}";
+    }
+}
+
+Profiler::Thread::Thread(Profiler* owner, const char* name, size_t capacity)
+    : profiler(owner), threadName(name), sets(QUERY_SETS), events(std::max<size_t>(capacity, 1)) {}
+
+void Profiler::Thread::begin(const char* name) {
+    open.push_back(Open{ name, profiler->now(), profiler->frame() });
+}
+
+void Profiler::Thread::end() {
+    if (open.empty()) return;
+    const Open o = open.back();
+    open.pop_back();
+    record(Event{ o.name, o.startNs, profiler->now() - o.startNs, o.frame, false });
+}
+
+void Profiler::Thread::beginGpu(const char* name) {
+    if (gpuOpen) {
+        gpuSkipped++;
+        return;
+    }
+    QuerySet& set = sets[current];
+    if (set.zones.size() == set.queries.size()) {
+        GLuint q = 0;
+        glGenQueries(1, &q);
+        set.queries.push_back(q);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, set.queries[set.zones.size()]);
+    set.zones.push_back(Open{ name, profiler->now(), profiler->frame() });
+    gpuOpen = true;
+}
+
+void Profiler::Thread::endGpu() {
+    if (gpuSkipped > 0) {
+        gpuSkipped--;
+        return;
+    }
+    if (!gpuOpen) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuOpen = false;
+}
+
+bool Profiler::Thread::readSet(QuerySet& set, bool wait) {
+    // the last query ends last; the others are checked too rather than
+    // relying on the order they complete in
+    for (size_t i = set.zones.size(); i > 0 && !wait; --i) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(set.queries[i - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    for (size_t i = 0; i < set.zones.size(); ++i) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT, &ns);
+        const Open& z = set.zones[i];
+        const uint64_t start = std::max(z.startNs, gpuTrackEnd);
+        record(Event{ z.name, start, uint64_t(ns), z.frame, true });
+        gpuTrackEnd = start + ns;
+    }
+    set.zones.clear();
+    return true;
+}
+
+void Profiler::Thread::collectGpu(bool wait) {
+    if (gpuOpen) return; // mid zone: next time
+    if (!sets[current].zones.empty()) {
+        size_t next = (current + 1) % sets.size();
+        if (next == oldest) {
+            // every other set still in flight: a new one after current
+            sets.insert(sets.begin() + ptrdiff_t(current + 1), QuerySet{});
+            if (oldest > current) oldest++;
+            next = current + 1;
+        }
+        current = next;
+    }
+    // in order, so the gpu track stays in submission order
+    while (oldest != current && readSet(sets[oldest], wait)) {
+        oldest = (oldest + 1) % sets.size();
+    }
+}
+
+void Profiler::Thread::destroy() {
+    for (QuerySet& set : sets) {
+        if (!set.queries.empty()) {
+            glDeleteQueries(GLsizei(set.queries.size()), set.queries.data());
+        }
+        set.queries.clear();
+        set.zones.clear();
+    }
+    current = 0;
+    oldest = 0;
+    gpuOpen = false;
+    gpuSkipped = 0;
+}
+
+void Profiler::Thread::record(const Event& e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events[next] = e;
+    next = (next + 1) % events.size();
+    count = std::min(count + 1, events.size());
+}
+
+Profiler::Profiler(size_t eventsPerThread_, size_t frames)
+    : epoch(std::chrono::steady_clock::now()), eventsPerThread(eventsPerThread_),
+      frameRing(std::max<size_t>(frames, 1)) {}
+
+uint64_t Profiler::now() const {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+Profiler::Thread* Profiler::thread(const char* name) {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    threads.push_back(std::make_unique<Thread>(this, name, eventsPerThread));
+    return threads.back().get();
+}
+
+void Profiler::beginFrame() {
+    frameStart = now();
+}
+
+void Profiler::endFrame() {
+    {
+        std::lock_guard<std::mutex> lock(framesMutex);
+        frameRing[frameNext] = Frame{ frame(), frameStart, now() - frameStart };
+        frameNext = (frameNext + 1) % frameRing.size();
+        frameCount = std::min(frameCount + 1, frameRing.size());
+    }
+    frameIndex.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<Profiler::Frame> Profiler::frames(size_t count) const {
+    std::lock_guard<std::mutex> lock(framesMutex);
+    count = std::min(count, frameCount);
+    std::vector<Frame> out;
+    out.reserve(count);
+    for (size_t i = count; i > 0; --i) {
+        out.push_back(frameRing[(frameNext + frameRing.size() - i) % frameRing.size()]);
+    }
+    return out;
+}
+
+bool Profiler::exportChromeTrace(std::ostream& out) const {
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    write_thread_name(out, FRAME_TID, "frames");
+    char name[32];
+    for (const Frame& f : frames(frameRing.size())) {
+        std::snprintf(name, sizeof(name), "frame %u", f.index);
+        out << ",\n";
+        write_complete(out, name, "frame", FRAME_TID, f.startNs, f.durationNs, f.index);
+    }
+
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    std::vector<Event> copy;
+    for (size_t t = 0; t < threads.size(); ++t) {
+        const Thread& th = *threads[t];
+        const int cpuTid = int(2 * t + 1);
+        const int gpuTid = cpuTid + 1;
+        out << ",\n";
+        write_thread_name(out, cpuTid, th.threadName);
+        out << ",\n";
+        write_thread_name(out, gpuTid, std::string(th.threadName) + " gpu");
+        {
+            std::lock_guard<std::mutex> ringLock(th.mutex);
+            copy.clear();
+            for (size_t i = th.count; i > 0; --i) {
+                copy.push_back(th.events[(th.next + th.events.size() - i) % th.events.size()]);
+            }
+        }
+        for (const Event& e : copy) {
+            out << ",\n";
+            write_complete(out, e.name, e.gpu ? "gpu" : "cpu", e.gpu ? gpuTid : cpuTid, e.startNs, e.durationNs, e.frame);
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
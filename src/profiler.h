@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+#include "config.h"
+
+// frame and generation profiler. every thread that records gets a Thread:
+// scoped cpu zones (ProfileZone) and gpu zones (GpuProfileZone, a
+// GL_TIME_ELAPSED query around the commands in between) go into its ring of
+// the last Config::PROFILER_EVENTS zones; the main thread also keeps a ring of
+// frames. exportChromeTrace() writes everything still in the rings as chrome
+// trace json (chrome://tracing, ui.perfetto.dev), from any thread.
+//
+// gpu zones go into a ring of query sets per thread: collectGpu(), once per
+// frame (or loop of the worker), closes the set being recorded and retires, in
+// order, the earlier sets whose results are available, never waiting for the
+// gpu; when every set is still in flight the ring grows. elapsed queries carry
+// no timestamp, so a gpu zone is placed at the cpu time it was submitted, or
+// right after the previous one on that thread's gpu track. gpu zones must not
+// nest; one begun inside another is not measured
+class Profiler {
+public:
+    struct Event {
+        const char* name = nullptr; // a string literal
+        uint64_t startNs = 0;       // since the profiler was created
+        uint64_t durationNs = 0;
+        uint32_t frame = 0;         // the main thread's frame when it began
+        bool gpu = false;
+    };
+
+    struct Frame {
+        uint32_t index = 0;
+        uint64_t startNs = 0;
+        uint64_t durationNs = 0;
+    };
+
+    class Thread {
+    public:
+        Thread(Profiler* owner, const char* name, size_t capacity);
+
+        Thread(const Thread&) = delete;
+        Thread& operator=(const Thread&) = delete;
+
+        void begin(const char* name);
+        void end();
+
+        // need this thread's context
+        void beginGpu(const char* name);
+        void endGpu();
+        // see above; wait: block until every set in flight is read (before
+        // destroy())
+        void collectGpu(bool wait = false);
+        // deletes the queries
+        void destroy();
+
+        const char* name() const { return threadName; }
+
+    private:
+        friend class Profiler;
+
+        struct Open {
+            const char* name;
+            uint64_t startNs;
+            uint32_t frame;
+        };
+
+        struct QuerySet {
+            std::vector<GLuint> queries; // grown on demand, reused
+            std::vector<Open> zones;     // one per query used
+        };
+
+        void record(const Event& e);
+        // records set's zones and empties it; false, leaving it as it is, if
+        // a result is not available yet and wait is false
+        bool readSet(QuerySet& set, bool wait);
+
+        Profiler* profiler;
+        const char* threadName;
+        std::vector<Open> open; // cpu zone stack
+
+        std::vector<QuerySet> sets; // ring: [oldest, current) in flight
+        size_t current = 0;         // being recorded
+        size_t oldest = 0;
+        bool gpuOpen = false;
+        int gpuSkipped = 0; // gpu zones begun inside the open one, not measured
+        uint64_t gpuTrackEnd = 0;
+
+        // ring, guarded for exportChromeTrace()
+        mutable std::mutex mutex;
+        std::vector<Event> events;
+        size_t next = 0;
+        size_t count = 0;
+    };
+
+    explicit Profiler(size_t eventsPerThread = Config::PROFILER_EVENTS, size_t frames = Config::PROFILER_FRAMES);
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // a new Thread recording under name; valid as long as the profiler
+    Thread* thread(const char* name);
+
+    // main thread, around each frame
+    void beginFrame();
+    void endFrame();
+    uint32_t frame() const { return frameIndex.load(std::memory_order_relaxed); }
+
+    uint64_t now() const;
+
+    // the last `count` frames, oldest first
+    std::vector<Frame> frames(size_t count) const;
+
+    // false when the stream failed
+    bool exportChromeTrace(std::ostream& out) const;
+
+private:
+    std::chrono::steady_clock::time_point epoch;
+    size_t eventsPerThread;
+
+    mutable std::mutex threadsMutex;
+    std::vector<std::unique_ptr<Thread>> threads;
+
+    std::atomic<uint32_t> frameIndex{0};
+    uint64_t frameStart = 0;
+    mutable std::mutex framesMutex;
+    std::vector<Frame> frameRing;
+    size_t frameNext = 0;
+    size_t frameCount = 0;
+};
+
+// a cpu zone for the enclosing scope; nothing without a thread
+class ProfileZone {
+public:
+    ProfileZone(Profiler::Thread* thread, const char* name) : t(thread) {
+        if (t) t->begin(name);
+    }
+    ~ProfileZone() {
+        if (t) t->end();
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    Profiler::Thread* t;
+};
+
+// a gpu zone for the enclosing scope; nothing without a thread
+class GpuProfileZone {
+public:
+    GpuProfileZone(Profiler::Thread* thread, const char* name) : t(thread) {
+        if (t) t->beginGpu(name);
+    }
+    ~GpuProfileZone() {
+        if (t) t->endGpu();
+    }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    Profiler::Thread* t;
+};
@@ -0,0 +1,215 @@
+#include "snoise.h"
+
+#include <algorithm>
+#include <cmath>
+
+// straight port of shaders/snoise.comp (Ashima Arts / stegu, MIT license).
+// kept component-wise so the operation order matches the glsl version.
+
+namespace {
+    inline float mod289(float x) {
+        return x - std::floor(x * (1.0f / 289.0f)) * 289.0f;
+    }
+
+    inline float permute(float x) {
+        return mod289(((x * 34.0f) + 10.0f) * x);
+    }
+
+    inline float taylor_inv_sqrt(float r) {
+        return 1.79284291400159f - 0.85373472095314f * r;
+    }
+
+    inline float step(float edge, float x) {
+        return x < edge ? 0.0f : 1.0f;
+    }
+}
+
+#if defined(TERRAIN_SIMD_X86)
+// per-isa kernels (snoise_avx2.cpp, snoise_avx512.cpp); return how many
+// leading elements they handled
+size_t snoise3_batch_avx2(const float* x, const float* y, const float* z, float* out, size_t n);
+size_t snoise2_batch_avx2(const float* x, const float* y, float* out, size_t n);
+size_t snoise3_batch_avx512(const float* x, const float* y, const float* z, float* out, size_t n);
+size_t snoise2_batch_avx512(const float* x, const float* y, float* out, size_t n);
+#endif
+
+namespace {
+    size_t snoise3_batch_none(const float*, const float*, const float*, float*, size_t) { return 0; }
+    size_t snoise2_batch_none(const float*, const float*, float*, size_t) { return 0; }
+
+    struct NoiseKernels {
+        size_t (*batch3)(const float*, const float*, const float*, float*, size_t);
+        size_t (*batch2)(const float*, const float*, float*, size_t);
+        const char* name;
+    };
+
+    // picked once from cpuid
+    NoiseKernels select_kernels() {
+#if defined(TERRAIN_SIMD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return { snoise3_batch_avx512, snoise2_batch_avx512, "avx512" };
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return { snoise3_batch_avx2, snoise2_batch_avx2, "avx2" };
+        }
+#endif
+        return { snoise3_batch_none, snoise2_batch_none, "scalar" };
+    }
+
+    const NoiseKernels& kernels() {
+        static const NoiseKernels k = select_kernels();
+        return k;
+    }
+}
+
+// 3D simplex noise
+float snoise(const glm::vec3& v) {
+    const float Cx = 1.0f / 6.0f;
+    const float Cy = 1.0f / 3.0f;
+
+    // first corner
+    float s = (v.x + v.y + v.z) * Cy;
+    float ix = std::floor(v.x + s);
+    float iy = std::floor(v.y + s);
+    float iz = std::floor(v.z + s);
+    float t = (ix + iy + iz) * Cx;
+    float x0[3] = { v.x - ix + t, v.y - iy + t, v.z - iz + t };
+
+    // other corners
+    float gx = step(x0[1], x0[0]);
+    float gy = step(x0[2], x0[1]);
+    float gz = step(x0[0], x0[2]);
+    float lx = 1.0f - gx;
+    float ly = 1.0f - gy;
+    float lz = 1.0f - gz;
+    float i1[3] = { std::min(gx, lz), std::min(gy, lx), std::min(gz, ly) };
+    float i2[3] = { std::max(gx, lz), std::max(gy, lx), std::max(gz, ly) };
+
+    float x1[3], x2[3], x3[3];
+    for (int k = 0; k < 3; ++k) {
+        x1[k] = x0[k] - i1[k] + Cx;
+        x2[k] = x0[k] - i2[k] + Cy;
+        x3[k] = x0[k] - 0.5f;
+    }
+
+    // permutations
+    ix = mod289(ix);
+    iy = mod289(iy);
+    iz = mod289(iz);
+    const float oz[4] = { 0.0f, i1[2], i2[2], 1.0f };
+    const float oy[4] = { 0.0f, i1[1], i2[1], 1.0f };
+    const float ox[4] = { 0.0f, i1[0], i2[0], 1.0f };
+
+    // gradients: 7x7 points over a square, mapped onto an octahedron
+    const float n_ = 0.142857142857f; // 1.0/7.0
+    const float nsx = n_ * 2.0f;
+    const float nsy = n_ * 0.5f - 1.0f;
+    const float nsz = n_;
+
+    const float* xs[4] = { x0, x1, x2, x3 };
+    float result = 0.0f;
+    for (int c = 0; c < 4; ++c) {
+        float p = permute(permute(permute(iz + oz[c]) + iy + oy[c]) + ix + ox[c]);
+
+        float j = p - 49.0f * std::floor(p * nsz * nsz);
+        float x_ = std::floor(j * nsz);
+        float y_ = std::floor(j - 7.0f * x_);
+
+        float x = x_ * nsx + nsy;
+        float y = y_ * nsx + nsy;
+        float h = 1.0f - std::fabs(x) - std::fabs(y);
+
+        float sh = -step(h, 0.0f);
+        float px = x + (std::floor(x) * 2.0f + 1.0f) * sh;
+        float py = y + (std::floor(y) * 2.0f + 1.0f) * sh;
+        float pz = h;
+
+        // normalise gradients
+        float norm = taylor_inv_sqrt(px * px + py * py + pz * pz);
+        px *= norm;
+        py *= norm;
+        pz *= norm;
+
+        // mix final noise value
+        const float* xc = xs[c];
+        float m = std::max(0.5f - (xc[0] * xc[0] + xc[1] * xc[1] + xc[2] * xc[2]), 0.0f);
+        m = m * m;
+        result += m * m * (px * xc[0] + py * xc[1] + pz * xc[2]);
+    }
+    return 105.0f * result;
+}
+
+// 2D simplex noise
+float snoise(const glm::vec2& v) {
+    const float Cx = 0.211324865405187f;  // (3.0-sqrt(3.0))/6.0
+    const float Cy = 0.366025403784439f;  // 0.5*(sqrt(3.0)-1.0)
+    const float Cz = -0.577350269189626f; // -1.0 + 2.0 * C.x
+    const float Cw = 0.024390243902439f;  // 1.0 / 41.0
+
+    // first corner
+    float s = (v.x + v.y) * Cy;
+    float ix = std::floor(v.x + s);
+    float iy = std::floor(v.y + s);
+    float t = (ix + iy) * Cx;
+    float x0x = v.x - ix + t;
+    float x0y = v.y - iy + t;
+
+    // other corners
+    float i1x = (x0x > x0y) ? 1.0f : 0.0f;
+    float i1y = 1.0f - i1x;
+    float x12[4] = { x0x + Cx - i1x, x0y + Cx - i1y, x0x + Cz, x0y + Cz };
+
+    // permutations
+    ix = mod289(ix);
+    iy = mod289(iy);
+    float p[3] = {
+        permute(permute(iy + 0.0f) + ix + 0.0f),
+        permute(permute(iy + i1y) + ix + i1x),
+        permute(permute(iy + 1.0f) + ix + 1.0f)
+    };
+
+    float m[3] = {
+        std::max(0.5f - (x0x * x0x + x0y * x0y), 0.0f),
+        std::max(0.5f - (x12[0] * x12[0] + x12[1] * x12[1]), 0.0f),
+        std::max(0.5f - (x12[2] * x12[2] + x12[3] * x12[3]), 0.0f)
+    };
+
+    // gradients: 41 points uniformly over a line, mapped onto a diamond
+    const float xs[3] = { x0x, x12[0], x12[2] };
+    const float ys[3] = { x0y, x12[1], x12[3] };
+    float result = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        float mc = m[c] * m[c];
+        mc = mc * mc;
+
+        float pw = p[c] * Cw;
+        float x = 2.0f * (pw - std::floor(pw)) - 1.0f;
+        float h = std::fabs(x) - 0.5f;
+        float ox = std::floor(x + 0.5f);
+        float a0 = x - ox;
+
+        // normalise gradients implicitly by scaling m
+        mc *= taylor_inv_sqrt(a0 * a0 + h * h);
+        result += mc * (a0 * xs[c] + h * ys[c]);
+    }
+    return 130.0f * result;
+}
+
+void snoise_batch(const float* x, const float* y, const float* z, float* out, size_t n) {
+    size_t i = kernels().batch3(x, y, z, out, n);
+    for (; i < n; ++i) {
+        out[i] = snoise(glm::vec3(x[i], y[i], z[i]));
+    }
+}
+
+void snoise_batch(const float* x, const float* y, float* out, size_t n) {
+    size_t i = kernels().batch2(x, y, out, n);
+    for (; i < n; ++i) {
+        out[i] = snoise(glm::vec2(x[i], y[i]));
+    }
+}
+
+const char* snoise_isa() {
+    return kernels().name;
+}
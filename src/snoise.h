@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// cpu ports of the simplex noise functions in shaders/snoise.comp
+float snoise(const glm::vec3& v);
+float snoise(const glm::vec2& v);
+
+// batched evaluation over structure-of-arrays input: out[i] = snoise(vec3(x[i], y[i], z[i])).
+// runs 16 (avx-512) or 8 (avx2) lanes per step when the cpu supports it,
+// otherwise the scalar path; results match the scalar version to float rounding
+void snoise_batch(const float* x, const float* y, const float* z, float* out, size_t n);
+void snoise_batch(const float* x, const float* y, float* out, size_t n);
+
+// name of the kernel snoise_batch dispatches to ("avx512", "avx2" or "scalar")
+const char* snoise_isa();
@@ -0,0 +1,22 @@
+// built with -mavx2 (see CMakeLists.txt); only called after a cpuid check
+#include <cstddef>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+    typedef float V __attribute__((vector_size(32)));
+
+    inline V vfloor(V x) {
+        return (V)_mm256_floor_ps((__m256)x);
+    }
+
+#include "snoise_simd.inl"
+}
+
+size_t snoise3_batch_avx2(const float* x, const float* y, const float* z, float* out, size_t n) {
+    return snoise3_batch_lanes(x, y, z, out, n);
+}
+
+size_t snoise2_batch_avx2(const float* x, const float* y, float* out, size_t n) {
+    return snoise2_batch_lanes(x, y, out, n);
+}
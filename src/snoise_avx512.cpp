@@ -0,0 +1,22 @@
+// built with -mavx512f (see CMakeLists.txt); only called after a cpuid check
+#include <cstddef>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+    typedef float V __attribute__((vector_size(64)));
+
+    inline V vfloor(V x) {
+        return (V)_mm512_roundscale_ps((__m512)x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    }
+
+#include "snoise_simd.inl"
+}
+
+size_t snoise3_batch_avx512(const float* x, const float* y, const float* z, float* out, size_t n) {
+    return snoise3_batch_lanes(x, y, z, out, n);
+}
+
+size_t snoise2_batch_avx512(const float* x, const float* y, float* out, size_t n) {
+    return snoise2_batch_lanes(x, y, out, n);
+}
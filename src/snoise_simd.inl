@@ -0,0 +1,174 @@
+// vectorized snoise kernels shared by the per-isa translation units
+// (snoise_avx2.cpp, snoise_avx512.cpp). each includes this inside an
+// anonymous namespace after defining:
+//   V           gcc/clang vector-extension float type (8 or 16 lanes)
+//   vfloor(V)   lane-wise floor
+// the operation order follows snoise.cpp / snoise.comp so results stay
+// within float rounding of the scalar path.
+
+constexpr int LANES = int(sizeof(V) / sizeof(float));
+
+inline V splat(float s) {
+    return V{} + s;
+}
+
+inline V load(const float* p) {
+    V v;
+    std::memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+inline void store(float* p, V v) {
+    std::memcpy(p, &v, sizeof(V));
+}
+
+inline V vmin(V a, V b) { return a < b ? a : b; }
+inline V vmax(V a, V b) { return a > b ? a : b; }
+inline V vabs(V a) { return a < 0.0f ? -a : a; }
+inline V vstep(V edge, V x) { return x < edge ? splat(0.0f) : splat(1.0f); }
+inline V mod289(V x) { return x - vfloor(x * (1.0f / 289.0f)) * 289.0f; }
+inline V permute(V x) { return mod289(((x * 34.0f) + 10.0f) * x); }
+inline V taylor_inv_sqrt(V r) { return 1.79284291400159f - 0.85373472095314f * r; }
+
+inline V snoise3_lanes(V vx, V vy, V vz) {
+    const float Cx = 1.0f / 6.0f;
+    const float Cy = 1.0f / 3.0f;
+
+    // first corner
+    V s = (vx + vy + vz) * Cy;
+    V ix = vfloor(vx + s);
+    V iy = vfloor(vy + s);
+    V iz = vfloor(vz + s);
+    V t = (ix + iy + iz) * Cx;
+    V x0[3] = { vx - ix + t, vy - iy + t, vz - iz + t };
+
+    // other corners
+    V gx = vstep(x0[1], x0[0]);
+    V gy = vstep(x0[2], x0[1]);
+    V gz = vstep(x0[0], x0[2]);
+    V lx = 1.0f - gx;
+    V ly = 1.0f - gy;
+    V lz = 1.0f - gz;
+    V i1[3] = { vmin(gx, lz), vmin(gy, lx), vmin(gz, ly) };
+    V i2[3] = { vmax(gx, lz), vmax(gy, lx), vmax(gz, ly) };
+
+    V x1[3], x2[3], x3[3];
+    for (int k = 0; k < 3; ++k) {
+        x1[k] = x0[k] - i1[k] + Cx;
+        x2[k] = x0[k] - i2[k] + Cy;
+        x3[k] = x0[k] - 0.5f;
+    }
+
+    // permutations
+    ix = mod289(ix);
+    iy = mod289(iy);
+    iz = mod289(iz);
+    const V oz[4] = { splat(0.0f), i1[2], i2[2], splat(1.0f) };
+    const V oy[4] = { splat(0.0f), i1[1], i2[1], splat(1.0f) };
+    const V ox[4] = { splat(0.0f), i1[0], i2[0], splat(1.0f) };
+
+    const float n_ = 0.142857142857f;
+    const float nsx = n_ * 2.0f;
+    const float nsy = n_ * 0.5f - 1.0f;
+    const float nsz = n_;
+
+    const V* xs[4] = { x0, x1, x2, x3 };
+    V result = splat(0.0f);
+    for (int c = 0; c < 4; ++c) {
+        V p = permute(permute(permute(iz + oz[c]) + iy + oy[c]) + ix + ox[c]);
+
+        V j = p - 49.0f * vfloor(p * nsz * nsz);
+        V x_ = vfloor(j * nsz);
+        V y_ = vfloor(j - 7.0f * x_);
+
+        V x = x_ * nsx + nsy;
+        V y = y_ * nsx + nsy;
+        V h = 1.0f - vabs(x) - vabs(y);
+
+        V sh = -vstep(h, splat(0.0f));
+        V px = x + (vfloor(x) * 2.0f + 1.0f) * sh;
+        V py = y + (vfloor(y) * 2.0f + 1.0f) * sh;
+        V pz = h;
+
+        V norm = taylor_inv_sqrt(px * px + py * py + pz * pz);
+        px *= norm;
+        py *= norm;
+        pz *= norm;
+
+        const V* xc = xs[c];
+        V m = vmax(0.5f - (xc[0] * xc[0] + xc[1] * xc[1] + xc[2] * xc[2]), splat(0.0f));
+        m = m * m;
+        result += m * m * (px * xc[0] + py * xc[1] + pz * xc[2]);
+    }
+    return 105.0f * result;
+}
+
+inline V snoise2_lanes(V vx, V vy) {
+    const float Cx = 0.211324865405187f;
+    const float Cy = 0.366025403784439f;
+    const float Cz = -0.577350269189626f;
+    const float Cw = 0.024390243902439f;
+
+    // first corner
+    V s = (vx + vy) * Cy;
+    V ix = vfloor(vx + s);
+    V iy = vfloor(vy + s);
+    V t = (ix + iy) * Cx;
+    V x0x = vx - ix + t;
+    V x0y = vy - iy + t;
+
+    // other corners
+    V i1x = x0x > x0y ? splat(1.0f) : splat(0.0f);
+    V i1y = 1.0f - i1x;
+    V x12[4] = { x0x + Cx - i1x, x0y + Cx - i1y, x0x + Cz, x0y + Cz };
+
+    // permutations
+    ix = mod289(ix);
+    iy = mod289(iy);
+    V p[3] = {
+        permute(permute(iy + 0.0f) + ix + 0.0f),
+        permute(permute(iy + i1y) + ix + i1x),
+        permute(permute(iy + 1.0f) + ix + 1.0f)
+    };
+
+    V m[3] = {
+        vmax(0.5f - (x0x * x0x + x0y * x0y), splat(0.0f)),
+        vmax(0.5f - (x12[0] * x12[0] + x12[1] * x12[1]), splat(0.0f)),
+        vmax(0.5f - (x12[2] * x12[2] + x12[3] * x12[3]), splat(0.0f))
+    };
+
+    const V xs[3] = { x0x, x12[0], x12[2] };
+    const V ys[3] = { x0y, x12[1], x12[3] };
+    V result = splat(0.0f);
+    for (int c = 0; c < 3; ++c) {
+        V mc = m[c] * m[c];
+        mc = mc * mc;
+
+        V pw = p[c] * Cw;
+        V x = 2.0f * (pw - vfloor(pw)) - 1.0f;
+        V h = vabs(x) - 0.5f;
+        V ox = vfloor(x + 0.5f);
+        V a0 = x - ox;
+
+        mc *= taylor_inv_sqrt(a0 * a0 + h * h);
+        result += mc * (a0 * xs[c] + h * ys[c]);
+    }
+    return 130.0f * result;
+}
+
+// full vectors only; the caller finishes the tail with the scalar path
+inline size_t snoise3_batch_lanes(const float* x, const float* y, const float* z, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        store(out + i, snoise3_lanes(load(x + i), load(y + i), load(z + i)));
+    }
+    return i;
+}
+
+inline size_t snoise2_batch_lanes(const float* x, const float* y, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        store(out + i, snoise2_lanes(load(x + i), load(y + i)));
+    }
+    return i;
+}
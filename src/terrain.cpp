@@ -0,0 +1,53 @@
+#include "terrain.h"
+#include "config.h"
+
+#include <cmath>
+
+namespace {
+    // |snoise| over either dimension, with headroom: sampling finds about 0.97
+    // (3d) and 0.9996 (2d), and the gpu rounds differently from the cpu port
+    constexpr float NOISE_BOUND = 1.1f;
+
+    float amplitude_sum(int octaves, float amplitude, float persistence) {
+        float sum = 0.0f;
+        for (int i = 0; i < octaves; ++i) {
+            sum += amplitude;
+            amplitude *= persistence;
+        }
+        return sum;
+    }
+
+    float shape_density(float density) {
+        return density > 0.0f ? std::pow(density, Terrain::DENSITY_EXP) : density;
+    }
+
+    // every sample's density lies in [lo, hi] before shaping (which keeps order)
+    Terrain::Occupancy classify(float lo, float hi) {
+        if (shape_density(lo) > Config::ISOLEVEL) return Terrain::Occupancy::Solid;
+        if (shape_density(hi) <= Config::ISOLEVEL) return Terrain::Occupancy::Air;
+        return Terrain::Occupancy::Unknown;
+    }
+}
+
+namespace Terrain {
+    Occupancy bound_occupancy(const glm::vec3& chunkWorldPos, float voxelScale, int terrainMode) {
+        // both modes: density = -(worldY * 0.25 + FLOOR_OFFSET) + base^noise * weight,
+        // falling with height; noise is bounded by the octave amplitudes
+        float bottom = chunkWorldPos.y * 0.25f;
+        float top = (chunkWorldPos.y + float(Config::CHUNK_HEIGHT) * voxelScale) * 0.25f;
+
+        float noiseMax, base, weight;
+        if (terrainMode == 0) {
+            noiseMax = NOISE_BOUND * amplitude_sum(OCTAVES_3D, BASE_AMPLITUDE_3D, PERSISTENCE_3D);
+            base = 2.0f;
+            weight = NOISE_WEIGHT_3D;
+        } else {
+            noiseMax = NOISE_BOUND * amplitude_sum(OCTAVES_2D, BASE_AMPLITUDE_2D, PERSISTENCE_2D);
+            base = 1.6f;
+            weight = NOISE_WEIGHT_2D;
+        }
+        float lo = -(top + FLOOR_OFFSET) + std::pow(base, -noiseMax) * weight;
+        float hi = -(bottom + FLOOR_OFFSET) + std::pow(base, noiseMax) * weight;
+        return classify(lo, hi);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// parameters of the terrain density function, shared by the cpu backend and
+// the bounds below; keep in sync with shaders/terrain.comp
+namespace Terrain {
+    constexpr float DENSITY_EXP = 0.7f;
+    constexpr float FLOOR_OFFSET = 1.0f;
+
+    constexpr int OCTAVES_3D = 4;
+    constexpr float BASE_FREQUENCY_3D = 0.0035f;
+    constexpr float BASE_AMPLITUDE_3D = 1.0f;
+    constexpr float LACUNARITY_3D = 2.0f;
+    constexpr float PERSISTENCE_3D = 0.5f;
+    constexpr float NOISE_WEIGHT_3D = 5.0f;
+
+    constexpr int OCTAVES_2D = 4;
+    constexpr float BASE_FREQUENCY_2D = 0.0035f;
+    constexpr float BASE_AMPLITUDE_2D = 4.0f;
+    constexpr float LACUNARITY_2D = 2.0f;
+    constexpr float PERSISTENCE_2D = 0.5f;
+    constexpr float NOISE_WEIGHT_2D = 5.0f;
+
+    enum class Occupancy : uint8_t {
+        Unknown, // the bounds allow a surface
+        Air,     // every sample at or below the isolevel
+        Solid,   // every sample above it
+    };
+
+    // conservative: Air or Solid only when no density sample of the chunk at
+    // chunkWorldPos (voxelScale apart) can lie on the other side of the
+    // isolevel, whatever the noise does. interval arithmetic over the octave
+    // sum; the chunk's position only enters through its height range
+    Occupancy bound_occupancy(const glm::vec3& chunkWorldPos, float voxelScale, int terrainMode);
+}
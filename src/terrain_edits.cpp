@@ -0,0 +1,378 @@
+#include "terrain_edits.h"
+#include "cpu_backend.h"
+#include "density_codec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+namespace {
+    const glm::ivec3 CELLS(Config::CHUNK_WIDTH, Config::CHUNK_HEIGHT, Config::CHUNK_DEPTH);
+    const glm::ivec3 CHUNK_IN_BRICKS = CELLS / TerrainEdits::BRICK;
+    // density change per world unit across the heightmap surface (terrain.comp
+    // scales world y by 0.25); Flatten's plane gets the same slope
+    constexpr float SURFACE_SLOPE = 0.25f;
+    // procedural chunk grids kept for Smooth and Flatten; a brush narrower
+    // than a chunk reads at most 2 per axis
+    constexpr size_t PROCEDURAL_GRIDS = 8;
+
+    constexpr char MAGIC[4] = { 'T', 'E', 'D', 'B' };
+    constexpr uint32_t VERSION = 2;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t brickPoints;
+        uint32_t bricks;
+    };
+    static_assert(sizeof(FileHeader) == 16, "edits file header must stay packed");
+
+    int floor_div(int v, int d) {
+        return (v >= 0 ? v : v - (d - 1)) / d;
+    }
+
+    glm::ivec3 floor_div(const glm::ivec3& v, const glm::ivec3& d) {
+        return glm::ivec3(floor_div(v.x, d.x), floor_div(v.y, d.y), floor_div(v.z, d.z));
+    }
+
+    size_t brick_index(const glm::ivec3& local) {
+        return (size_t(local.z) * TerrainEdits::BRICK + local.y) * TerrainEdits::BRICK + local.x;
+    }
+}
+
+TerrainEdits::TerrainEdits(int terrainMode_) : terrainMode(terrainMode_) {}
+
+float TerrainEdits::procedural(const glm::ivec3& p) {
+    // a face point belongs to the chunk it is the low corner of
+    const glm::ivec3 c = floor_div(p, CELLS);
+    auto it = std::find_if(procCache.begin(), procCache.end(),
+                           [&](const ProceduralGrid& g) { return g.coord == c; });
+    if (it == procCache.end()) {
+        if (procCache.size() < PROCEDURAL_GRIDS) {
+            procCache.emplace_back();
+            procCache.back().densities.resize(CpuMesher::NUM_POINTS);
+        }
+        it = procCache.end() - 1; // the least recently used
+        it->coord = c;
+        CpuMesher::fill_density(glm::vec3(c * CELLS), 1.0f, terrainMode, it->densities.data());
+    }
+    std::rotate(procCache.begin(), it, it + 1);
+    const glm::ivec3 l = p - c * CELLS;
+    return procCache.front().densities[CpuMesher::density_index(l.x, l.y, l.z)];
+}
+
+float TerrainEdits::delta(const glm::ivec3& p) const {
+    const glm::ivec3 b = floor_div(p, glm::ivec3(BRICK));
+    auto it = slots.find(key64(b.x, b.y, b.z));
+    if (it == slots.end()) return 0.0f;
+    return deltas[size_t(it->second) * BRICK_POINTS + brick_index(p - b * BRICK)];
+}
+
+float TerrainEdits::density(const glm::ivec3& p) {
+    return procedural(p) + delta(p);
+}
+
+uint32_t TerrainEdits::createBrick(const glm::ivec3& b) {
+    const uint32_t slot = uint32_t(coords.size());
+    slots.emplace(key64(b.x, b.y, b.z), slot);
+    coords.push_back(b);
+    deltas.resize(deltas.size() + BRICK_POINTS, 0.0f);
+    slotDirty.push_back(0);
+
+    // per lod the chunk holding it, and on a chunk's low face also the one
+    // below
+    for (int lod = 0; lod < Config::LOD_LEVELS; ++lod) {
+        const glm::ivec3 span = CHUNK_IN_BRICKS * (1 << lod);
+        const glm::ivec3 c = floor_div(b, span);
+        const glm::ivec3 first = c * span;
+        const glm::ivec3 face(b.x == first.x, b.y == first.y, b.z == first.z);
+        for (int dz = 0; dz <= face.z; ++dz) {
+            for (int dy = 0; dy <= face.y; ++dy) {
+                for (int dx = 0; dx <= face.x; ++dx) {
+                    const glm::ivec3 n = c - glm::ivec3(dx, dy, dz);
+                    EditedChunk& chunk = chunks[key64(n.x, n.y, n.z, lod)];
+                    chunk.key = ChunkKey{ n.x, n.y, n.z, lod };
+                    chunk.bricks++;
+                }
+            }
+        }
+    }
+    return slot;
+}
+
+float& TerrainEdits::deltaAt(const glm::ivec3& p) {
+    const glm::ivec3 b = floor_div(p, glm::ivec3(BRICK));
+    auto it = slots.find(key64(b.x, b.y, b.z));
+    const uint32_t slot = it != slots.end() ? it->second : createBrick(b);
+    if (!slotDirty[slot]) {
+        slotDirty[slot] = 1;
+        dirtySlots.push_back(slot);
+    }
+    return deltas[size_t(slot) * BRICK_POINTS + brick_index(p - b * BRICK)];
+}
+
+size_t TerrainEdits::touch(const glm::ivec3& lo, const glm::ivec3& hi) {
+    // chunk c of a lod holds lod 0 points [c * size, c * size + size]
+    size_t marked = 0;
+    for (int lod = 0; lod < Config::LOD_LEVELS; ++lod) {
+        const glm::ivec3 size = CELLS * (1 << lod);
+        const glm::ivec3 cMin = floor_div(lo - 1, size);
+        const glm::ivec3 cMax = floor_div(hi, size);
+        for (int cz = cMin.z; cz <= cMax.z; ++cz) {
+            for (int cy = cMin.y; cy <= cMax.y; ++cy) {
+                for (int cx = cMin.x; cx <= cMax.x; ++cx) {
+                    auto it = chunks.find(key64(cx, cy, cz, lod));
+                    if (it == chunks.end()) continue;
+                    if (!it->second.dirty) {
+                        it->second.dirty = true;
+                        dirtyList.push_back(it->second.key);
+                    }
+                    marked++;
+                }
+            }
+        }
+    }
+    return marked;
+}
+
+size_t TerrainEdits::apply(const Brush& b) {
+    if (!(b.radius > 0.0f)) return 0;
+    const glm::ivec3 lo(glm::ceil(b.center - b.radius));
+    const glm::ivec3 hi(glm::floor(b.center + b.radius));
+    const glm::ivec3 size = hi - lo + 1;
+    if (size.x < 1 || size.y < 1 || size.z < 1) return 0;
+
+    // every new delta first, from the old densities (smoothing reads
+    // neighbours). NaN: outside the sphere
+    const float untouched = std::numeric_limits<float>::quiet_NaN();
+    const glm::vec3 normal = glm::normalize(b.normal);
+    scratch.assign(size_t(size.x) * size.y * size.z, untouched);
+    for (int z = 0; z < size.z; ++z) {
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                const glm::ivec3 p = lo + glm::ivec3(x, y, z);
+                const float dist = glm::length(glm::vec3(p) - b.center);
+                if (dist > b.radius) continue;
+                const float t = dist / b.radius;
+                const float falloff = (1.0f - t * t) * (1.0f - t * t);
+                const float blend = std::clamp(b.strength * falloff, 0.0f, 1.0f);
+
+                // add and subtract never need the noise
+                const float old = delta(p);
+                float v = old;
+                switch (b.kind) {
+                case Brush::Kind::Add:
+                    v = old + b.strength * falloff;
+                    break;
+                case Brush::Kind::Subtract:
+                    v = old - b.strength * falloff;
+                    break;
+                case Brush::Kind::Smooth: {
+                    float mean = 0.0f;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        glm::ivec3 e(0);
+                        e[axis] = 1;
+                        mean += density(p - e) + density(p + e);
+                    }
+                    v = old + (mean / 6.0f - density(p)) * blend;
+                    break;
+                }
+                case Brush::Kind::Flatten: {
+                    float plane = glm::dot(b.center - glm::vec3(p), normal) * SURFACE_SLOPE;
+                    v = old + (plane - density(p)) * blend;
+                    break;
+                }
+                }
+                scratch[(size_t(z) * size.y + y) * size.x + x] = v;
+            }
+        }
+    }
+
+    for (int z = 0; z < size.z; ++z) {
+        for (int y = 0; y < size.y; ++y) {
+            for (int x = 0; x < size.x; ++x) {
+                const float v = scratch[(size_t(z) * size.y + y) * size.x + x];
+                if (!std::isnan(v)) deltaAt(lo + glm::ivec3(x, y, z)) = v;
+            }
+        }
+    }
+    return touch(lo, hi);
+}
+
+const TerrainEdits::EditedChunk* TerrainEdits::find(const ChunkKey& key) const {
+    auto it = chunks.find(key64(key));
+    return it != chunks.end() ? &it->second : nullptr;
+}
+
+void TerrainEdits::takeDirty(std::vector<ChunkKey>& out) {
+    for (const ChunkKey& key : dirtyList) {
+        chunks.find(key64(key))->second.dirty = false;
+        out.push_back(key);
+    }
+    dirtyList.clear();
+}
+
+void TerrainEdits::markDirty(const ChunkKey& key) {
+    auto it = chunks.find(key64(key));
+    if (it != chunks.end() && !it->second.dirty) {
+        it->second.dirty = true;
+        dirtyList.push_back(it->second.key);
+    }
+}
+
+void TerrainEdits::brickTable(const ChunkKey& key, uint32_t* table) const {
+    const glm::ivec3 base = glm::ivec3(key.x, key.y, key.z) * CHUNK_IN_BRICKS;
+    for (int z = 0; z < TABLE_Z; ++z) {
+        for (int y = 0; y < TABLE_Y; ++y) {
+            for (int x = 0; x < TABLE_X; ++x) {
+                auto it = slots.find(key64(base.x + x, base.y + y, base.z + z));
+                *table++ = it != slots.end() ? it->second : NO_BRICK;
+            }
+        }
+    }
+}
+
+void TerrainEdits::sampleBricks(const ChunkKey& key, uint32_t* table, std::vector<float>& out) const {
+    const int step = 1 << key.lod;
+    const glm::ivec3 origin = glm::ivec3(key.x, key.y, key.z) * CELLS * step;
+    std::fill(table, table + TABLE_SIZE, NO_BRICK);
+
+    // the table bricks holding a point of some overlay brick: the overlay is
+    // sparse next to the lod 0 bricks a coarse chunk spans
+    uint32_t slot = uint32_t(out.size() / BRICK_POINTS);
+    for (const glm::ivec3& b : coords) {
+        // the brick's points that are the chunk's, as its point indices
+        const glm::ivec3 lo = b * BRICK - origin;
+        const glm::ivec3 first = glm::max(floor_div(lo + (step - 1), glm::ivec3(step)), glm::ivec3(0));
+        const glm::ivec3 last = glm::min(floor_div(lo + (BRICK - 1), glm::ivec3(step)), CELLS);
+        if (first.x > last.x || first.y > last.y || first.z > last.z) continue;
+        for (int z = first.z / BRICK; z <= last.z / BRICK; ++z) {
+            for (int y = first.y / BRICK; y <= last.y / BRICK; ++y) {
+                for (int x = first.x / BRICK; x <= last.x / BRICK; ++x) {
+                    uint32_t& entry = table[(size_t(z) * TABLE_Y + y) * TABLE_X + x];
+                    if (entry == NO_BRICK) entry = slot++;
+                }
+            }
+        }
+    }
+
+    out.resize(size_t(slot) * BRICK_POINTS, 0.0f);
+    for (int z = 0; z < TABLE_Z; ++z) {
+        for (int y = 0; y < TABLE_Y; ++y) {
+            for (int x = 0; x < TABLE_X; ++x) {
+                const uint32_t s = table[(size_t(z) * TABLE_Y + y) * TABLE_X + x];
+                if (s == NO_BRICK) continue;
+                float* brick = out.data() + size_t(s) * BRICK_POINTS;
+                const glm::ivec3 first = glm::ivec3(x, y, z) * BRICK;
+                const glm::ivec3 last = glm::min(first + (BRICK - 1), CELLS);
+                for (int pz = first.z; pz <= last.z; ++pz) {
+                    for (int py = first.y; py <= last.y; ++py) {
+                        for (int px = first.x; px <= last.x; ++px) {
+                            const glm::ivec3 p(px, py, pz);
+                            brick[brick_index(p - first)] = delta(origin + p * step);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TerrainEdits::takeDirtyBricks(std::vector<uint32_t>& out) {
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    for (uint32_t slot : dirtySlots) {
+        slotDirty[slot] = 0;
+    }
+    out.insert(out.end(), dirtySlots.begin(), dirtySlots.end());
+    dirtySlots.clear();
+}
+
+size_t TerrainEdits::memoryBytes() const {
+    // hash nodes counted as the pair and a next pointer
+    const size_t slotBytes = slots.size() * (sizeof(std::pair<const long long, uint32_t>) + sizeof(void*))
+                           + slots.bucket_count() * sizeof(void*);
+    const size_t chunkBytes = chunks.size() * (sizeof(std::pair<const long long, EditedChunk>) + sizeof(void*))
+                            + chunks.bucket_count() * sizeof(void*);
+    return deltas.capacity() * sizeof(float) + coords.capacity() * sizeof(glm::ivec3)
+         + slotDirty.capacity() + slotBytes + chunkBytes;
+}
+
+size_t TerrainEdits::denseBytes() const {
+    return chunks.size() * CpuMesher::NUM_POINTS * sizeof(float);
+}
+
+bool TerrainEdits::save(std::ostream& out) {
+    FileHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.brickPoints = BRICK_POINTS;
+    h.bricks = uint32_t(coords.size());
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    // deltas are not bounded like densities, and their sum with the noise is
+    // what meshes: each brick is quantized over its own largest delta, so none
+    // saturates and the steps stay fine where the edits are faint. the codec
+    // keeps deltas on their side of 0, not sums on theirs of the isolevel, so
+    // each delta goes in as a whole number of steps, one further towards the
+    // sum's side where the nearest would cross it
+    DensityCodec::Writer writer(out, DensityCodec::Quantization{}, BRICK_POINTS);
+    float rounded[BRICK_POINTS];
+    for (size_t slot = 0; slot < coords.size(); ++slot) {
+        const float* brick = deltas.data() + slot * BRICK_POINTS;
+        float largest = 0.0f;
+        for (int i = 0; i < BRICK_POINTS; ++i) {
+            largest = std::max(largest, std::abs(brick[i]));
+        }
+        DensityCodec::Quantization q;
+        q.range = largest > 0.0f ? largest : 1.0f;
+        q.isolevel = 0.0f; // untouched points stay exactly 0
+        const float step = DensityCodec::stepSize(q);
+
+        const glm::ivec3 origin = coords[slot] * BRICK;
+        for (int z = 0; z < BRICK; ++z) {
+            for (int y = 0; y < BRICK; ++y) {
+                for (int x = 0; x < BRICK; ++x) {
+                    const size_t i = brick_index(glm::ivec3(x, y, z));
+                    const float proc = procedural(origin + glm::ivec3(x, y, z));
+                    const bool inside = proc + brick[i] > Config::ISOLEVEL;
+                    int s = int(std::lround(brick[i] / step));
+                    if (inside && !(proc + float(s) * step > Config::ISOLEVEL)) s++;
+                    if (!inside && proc + float(s) * step > Config::ISOLEVEL) s--;
+                    rounded[i] = float(s) * step;
+                }
+            }
+        }
+        const glm::ivec3& b = coords[slot];
+        if (!writer.write(ChunkKey{ b.x, b.y, b.z, 0 }, rounded, q)) return false;
+    }
+    return bool(out);
+}
+
+bool TerrainEdits::load(std::istream& in) {
+    FileHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (in.gcount() != std::streamsize(sizeof(h)) || std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0
+        || h.version != VERSION || h.brickPoints != BRICK_POINTS) {
+        return false;
+    }
+
+    DensityCodec::Reader reader(in, BRICK_POINTS);
+    float brick[BRICK_POINTS];
+    for (uint32_t i = 0; i < h.bricks; ++i) {
+        ChunkKey key{};
+        if (!reader.next(key, brick)) return false;
+
+        const glm::ivec3 origin = glm::ivec3(key.x, key.y, key.z) * BRICK;
+        for (int z = 0; z < BRICK; ++z) {
+            for (int y = 0; y < BRICK; ++y) {
+                for (int x = 0; x < BRICK; ++x) {
+                    deltaAt(origin + glm::ivec3(x, y, z)) = brick[brick_index(glm::ivec3(x, y, z))];
+                }
+            }
+        }
+        touch(origin, origin + (BRICK - 1));
+    }
+    return true;
+}
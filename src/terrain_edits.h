@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "config.h"
+#include "worker_types.h"
+
+// sculpting: edits are density deltas on top of the procedural terrain, kept
+// in a sparse overlay of bricks of BRICK^3 lod 0 points hashed by brick
+// coordinate, so only the bricks a brush touched cost memory. density.comp adds
+// them to the noise given the chunk's brickTable() (see EditRemesher), density()
+// does the same on the cpu. bricks are in world points, so a point on a chunk
+// face is stored once for both chunks sharing it. coarser lods sample the
+// overlay at their own points (sampleBricks()), so a chunk's seam face and its
+// coarser neighbour's agree. main thread only
+struct Brush {
+    enum class Kind : uint8_t {
+        Add,      // density += strength * falloff
+        Subtract, // density -= strength * falloff
+        Smooth,   // towards the mean of the 6 neighbours, blend strength * falloff
+        Flatten,  // towards a plane through center facing normal, same blend
+    };
+
+    Kind kind = Kind::Add;
+    glm::vec3 center{0.0f}; // world units
+    float radius = Config::EDIT_BRUSH_RADIUS; // world units, lod 0 voxels
+    float strength = 1.0f;
+    glm::vec3 normal{0.0f, 1.0f, 0.0f}; // Flatten
+};
+
+class TerrainEdits {
+public:
+    // points per brick side, mirrored in shaders/density.comp
+    static constexpr int BRICK = 8;
+    static constexpr int BRICK_POINTS = BRICK * BRICK * BRICK;
+    // bricks a chunk's points [0, CHUNK_*] span per axis; the last one only
+    // for the far face
+    static constexpr int TABLE_X = Config::CHUNK_WIDTH / BRICK + 1;
+    static constexpr int TABLE_Y = Config::CHUNK_HEIGHT / BRICK + 1;
+    static constexpr int TABLE_Z = Config::CHUNK_DEPTH / BRICK + 1;
+    static constexpr size_t TABLE_SIZE = size_t(TABLE_X) * TABLE_Y * TABLE_Z;
+    static constexpr uint32_t NO_BRICK = 0xffffffffu;
+
+    static_assert(Config::CHUNK_WIDTH % BRICK == 0 && Config::CHUNK_HEIGHT % BRICK == 0
+                  && Config::CHUNK_DEPTH % BRICK == 0, "chunks must be whole bricks");
+
+    struct EditedChunk {
+        ChunkKey key{};
+        uint32_t bricks = 0; // overlapping its points
+        bool dirty = false;  // changed since the last takeDirty()
+    };
+
+    explicit TerrainEdits(int terrainMode = Config::TERRAIN_MODE);
+
+    TerrainEdits(const TerrainEdits&) = delete;
+    TerrainEdits& operator=(const TerrainEdits&) = delete;
+
+    // applies b to every lod 0 density point within its radius; returns how
+    // many edited chunks (of any lod) it marked dirty
+    size_t apply(const Brush& b);
+
+    // density at a lod 0 point: procedural plus the overlay
+    float density(const glm::ivec3& worldPoint);
+    // the overlay alone, 0 outside every brick
+    float delta(const glm::ivec3& worldPoint) const;
+
+    // nullptr unless a brick overlaps key's points, of any lod
+    const EditedChunk* find(const ChunkKey& key) const;
+
+    // the chunks changed since the last call; clears them
+    void takeDirty(std::vector<ChunkKey>& out);
+
+    // the chunk dirty again, e.g. when it is wanted again after being dropped
+    void markDirty(const ChunkKey& key);
+
+    // slot of every brick key's points span, TABLE_SIZE entries x fastest,
+    // NO_BRICK where nothing was edited. lod 0 chunks only
+    void brickTable(const ChunkKey& key, uint32_t* table) const;
+    // the same table for a chunk of any lod, over bricks of its own points
+    // (every 2^lod-th lod 0 point) sampled from the overlay: their deltas are
+    // appended to out, slots counting from out's size on entry
+    void sampleBricks(const ChunkKey& key, uint32_t* table, std::vector<float>& out) const;
+    // BRICK_POINTS deltas per slot, x fastest within the brick
+    const std::vector<float>& brickDeltas() const { return deltas; }
+    // slots written since the last call, ascending; clears them
+    void takeDirtyBricks(std::vector<uint32_t>& out);
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t brickCount() const { return coords.size(); }
+    // the overlay with its indices, and what dense grids of the edited chunks
+    // would take instead
+    size_t memoryBytes() const;
+    size_t denseBytes() const;
+
+    // every brick, through DensityCodec (quantized, runs packed, a brick of
+    // one value stored once), each point's sum with the procedural density
+    // kept on its side of the isolevel; load() adds to (and replaces) the
+    // bricks held and marks their chunks dirty. false on a write or format
+    // error
+    bool save(std::ostream& out);
+    bool load(std::istream& in);
+
+private:
+    struct ProceduralGrid {
+        glm::ivec3 coord{0};
+        std::vector<float> densities; // CpuMesher::fill_density
+    };
+
+    // procedural density at a lod 0 point, from a few cached chunk grids
+    float procedural(const glm::ivec3& p);
+    // p's delta, creating its brick
+    float& deltaAt(const glm::ivec3& p);
+    uint32_t createBrick(const glm::ivec3& brickCoord);
+    // marks the edited chunks of every lod whose points overlap [lo, hi];
+    // returns how many
+    size_t touch(const glm::ivec3& lo, const glm::ivec3& hi);
+
+    int terrainMode;
+    std::unordered_map<long long, uint32_t> slots;     // brick coordinate -> slot
+    std::vector<glm::ivec3> coords;                    // per slot
+    std::vector<float> deltas;                         // per slot, BRICK_POINTS
+    std::vector<uint8_t> slotDirty;                    // per slot
+    std::vector<uint32_t> dirtySlots;
+    std::unordered_map<long long, EditedChunk> chunks; // overlapped by a brick, key64 with lod
+    std::vector<ChunkKey> dirtyList;                   // chunks with dirty set
+    std::vector<ProceduralGrid> procCache;             // most recently used first
+    std::vector<float> scratch;                        // new deltas of the brush's points
+};
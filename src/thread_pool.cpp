@@ -0,0 +1,124 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    // which pool/worker the current thread belongs to, so submit() from inside a task stays local
+    thread_local const void* tlsPool = nullptr;
+    thread_local unsigned tlsWorker = 0;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned workerCount) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers[i]->th = std::thread([this, i]{ run(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    shutdown();
+}
+
+void WorkStealingPool::submit(Task task) {
+    unsigned index = (tlsPool == this)
+        ? tlsWorker
+        : nextWorker.fetch_add(1, std::memory_order_relaxed) % unsigned(workers.size());
+    {
+        std::lock_guard<std::mutex> lk(workers[index]->m);
+        workers[index]->q.push_back(std::move(task));
+    }
+    pending.fetch_add(1, std::memory_order_release);
+
+    // taking the lock orders the increment against a worker about to sleep
+    std::lock_guard<std::mutex> lk(sleepM);
+    sleepCv.notify_one();
+}
+
+void WorkStealingPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(sleepM);
+        if (stopping) return;
+        stopping = true;
+    }
+    sleepCv.notify_all();
+    for (auto& w : workers) {
+        if (w->th.joinable()) {
+            w->th.join();
+        }
+    }
+}
+
+std::vector<WorkStealingPool::WorkerStats> WorkStealingPool::stats() const {
+    std::vector<WorkerStats> out;
+    out.reserve(workers.size());
+    for (const auto& w : workers) {
+        out.push_back({ w->executed.load(), w->stolen.load(), w->busyNs.load(), w->sleeps.load() });
+    }
+    return out;
+}
+
+bool WorkStealingPool::popLocal(unsigned index, Task& out) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> lk(w.m);
+    if (w.q.empty()) return false;
+    out = std::move(w.q.back());
+    w.q.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned thief, Task& out) {
+    const unsigned n = unsigned(workers.size());
+    for (unsigned k = 1; k < n; ++k) {
+        Worker& victim = *workers[(thief + k) % n];
+        std::unique_lock<std::mutex> lk(victim.m, std::try_to_lock);
+        if (!lk.owns_lock() || victim.q.empty()) continue;
+        out = std::move(victim.q.front());
+        victim.q.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::run(unsigned index) {
+    tlsPool = this;
+    tlsWorker = index;
+    Worker& self = *workers[index];
+
+    while (true) {
+        Task task;
+        bool found = popLocal(index, task);
+        bool stolen = false;
+        if (!found) {
+            found = stolen = steal(index, task);
+        }
+
+        if (found) {
+            pending.fetch_sub(1, std::memory_order_acq_rel);
+            auto t0 = std::chrono::steady_clock::now();
+            task();
+            auto t1 = std::chrono::steady_clock::now();
+            self.executed.fetch_add(1, std::memory_order_relaxed);
+            if (stolen) self.stolen.fetch_add(1, std::memory_order_relaxed);
+            self.busyNs.fetch_add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()), std::memory_order_relaxed);
+            continue;
+        }
+
+        // a try_lock miss in steal() can leave pending > 0 with nothing found; the
+        // predicate then returns at once and we simply retry
+        std::unique_lock<std::mutex> lk(sleepM);
+        if (pending.load(std::memory_order_acquire) == 0) {
+            if (stopping) break;
+            self.sleeps.fetch_add(1, std::memory_order_relaxed);
+            sleepCv.wait(lk, [&]{ return stopping || pending.load(std::memory_order_acquire) > 0; });
+        }
+    }
+
+    tlsPool = nullptr;
+}
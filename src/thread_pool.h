@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed-size pool with one deque per worker. a worker pushes and pops its own
+// deque at the back (lifo, keeps continuations cache-hot) and, when empty,
+// steals from the front of the others before going to sleep.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    struct WorkerStats {
+        uint64_t executed = 0; // tasks run by this worker
+        uint64_t stolen = 0;   // of those, taken from another worker's deque
+        uint64_t busyNs = 0;   // time spent inside tasks
+        uint64_t sleeps = 0;   // times the worker found no work and blocked
+    };
+
+    // workers == 0 uses std::thread::hardware_concurrency()
+    explicit WorkStealingPool(unsigned workers = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // called from a worker the task goes to that worker's own deque,
+    // otherwise deques are filled round-robin
+    void submit(Task task);
+
+    // runs every queued task to completion, then joins the workers
+    void shutdown();
+
+    unsigned workerCount() const { return unsigned(workers.size()); }
+    std::vector<WorkerStats> stats() const;
+
+private:
+    struct alignas(64) Worker {
+        std::mutex m;
+        std::deque<Task> q;
+        std::thread th;
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> sleeps{0};
+    };
+
+    void run(unsigned index);
+    bool popLocal(unsigned index, Task& out);
+    bool steal(unsigned thief, Task& out);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex sleepM;
+    std::condition_variable sleepCv;
+    std::atomic<size_t> pending{0};
+    std::atomic<unsigned> nextWorker{0};
+    bool stopping = false;
+};
@@ -1,29 +1,67 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include <vector>
+#include "gpu_buffer_pool.h"
 
+// chunk coordinate at a level of detail: a lod n chunk has the usual
+// CHUNK_WIDTH^3 voxels, each 2^n world units wide, so x/y/z count in units of
+// 2^n chunk widths
 struct ChunkKey {
     int x, y, z;
+    int lod = 0;
 };
 
 inline bool operator==(const ChunkKey &a, const ChunkKey &b) {
-    return a.x == b.x && a.y == b.y && a.z == b.z;
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.lod == b.lod;
+}
+
+// packs a chunk coordinate into one integer, 20 bits per axis and 4 for the lod
+inline long long key64(int x, int y, int z, int lod = 0) {
+    return ( (long long)(lod & 0xF)<<60 ) | ( ((long long)x & 0xFFFFF)<<40 ) | ( ((long long)y & 0xFFFFF)<<20 ) | ((long long)z & 0xFFFFF);
+}
+
+inline long long key64(const ChunkKey& k) {
+    return key64(k.x, k.y, k.z, k.lod);
+}
+
+// world units per voxel of a lod
+inline float lod_scale(int lod) {
+    return float(1 << lod);
 }
 
 struct GenJob {
     ChunkKey key;
     glm::vec3 worldPos;
+    uint32_t slotHint = 0; // known mesh size (mesh_slots) when regenerating an overflowed chunk
+    uint8_t seams = 0; // faces bordering a coarser lod, bit 2 * axis + (0 low, 1 high side)
+};
+
+// one chunk of a batched dispatch; std430 layout of BatchChunk in
+// shaders/chunk_batch.comp
+struct BatchChunk {
+    glm::vec4 worldPos{0.0f}; // w: voxel scale
+    uint32_t heightBase = 0;
+    uint32_t baseVertex = 0;
+    uint32_t vertexCapacity = 0;
+    uint32_t slab = 0;
 };
+static_assert(sizeof(BatchChunk) == 32, "must match the std430 layout");
 
 struct GenResult {
     ChunkKey key;
     glm::vec3 worldPos;
-    GLuint vertexSSBO = 0; // (3*uint32 per vertex)
-    GLuint indirect = 0;
-    GLuint counterSSBO = 0;
+    VertexRange vertices; // pool slab range holding the packed uvec2 vertices, then the indices
+    GLuint counterSSBO = 0; // pooled scratch, handed back by World::collectFinished
     GLuint densitySSBO = 0;
     GLuint offsetsSSBO = 0;
     GLsync fence = 0;
     GLuint totalVertices = 0;
+    GLuint totalIndices = 0;
+    uint8_t seams = 0; // the job's seam mask the mesh was built with
+    bool countOnGpu = false; // totals not read yet; they are in counterSSBO
+    std::vector<glm::uvec2> cpuVertices; // cpu backend output, uploaded by World::collectFinished
+    std::vector<uint32_t> cpuIndices;
 };
@@ -1,127 +1,565 @@
-#include "world.h"
-#include "chunk.h"
-#include "frustum.h"
-#include "job_queues.h"
-#include "worker_types.h"
-#include <cmath>
-#include <iostream>
-#include <vector>
-
-#include <glad/glad.h>
-#include <glm/gtc/matrix_transform.hpp>
-
-World::World(unsigned int densityProg, unsigned int mcCountProg, unsigned int mcEmitProg, BlockingQueue<GenJob>* jobIn, SPSCQueue<GenResult>* jobOut) : densityProgram(densityProg), mcCountProgram(mcCountProg), mcEmitProgram(mcEmitProg), genIn(jobIn), genOut(jobOut) {}
-
-void World::update(const glm::vec3& playerPos) {
-    glm::ivec3 playerChunkCoord(
-        floor(playerPos.x / Chunk::CHUNK_WIDTH),
-        floor(playerPos.y / Chunk::CHUNK_HEIGHT),
-        floor(playerPos.z / Chunk::CHUNK_DEPTH)
-    );
-
-    // check if chunks need to be unloaded
-    std::vector<glm::ivec3> unloadChunks;
-    for (auto const& [coord, chunk] : activeChunks) {
-        int dist_x = abs(coord.x - playerChunkCoord.x);
-        int dist_y = abs(coord.y - playerChunkCoord.y);
-        int dist_z = abs(coord.z - playerChunkCoord.z);
-        if (dist_x > viewDistance || dist_y > viewDistance || dist_z > viewDistance) {
-            unloadChunks.push_back(coord);
-        }
-    }
-
-    // call destructor of unloading chunks
-    for (const auto& coord : unloadChunks) {
-        activeChunks.erase(coord);
-        requestedKeys.erase(key64(coord.x, coord.y, coord.z));
-    }
-
-    // all chunks within range of player's current chunk get loaded if not already
-    for (int x = -viewDistance; x <= viewDistance; x++) {
-        for (int y = -4; y <= 4; y++) {
-            for (int z = -viewDistance; z <= viewDistance; z++) {
-                glm::ivec3 chunkCoord = playerChunkCoord + glm::ivec3(x, y, z);
-                if (activeChunks.find(chunkCoord) != activeChunks.end()) continue;
-                long long k = key64(chunkCoord.x, chunkCoord.y, chunkCoord.z);
-                if (requestedKeys.count(k)) continue;
-
-                glm::vec3 chunkWorldPos(
-                    chunkCoord.x * Chunk::CHUNK_WIDTH,
-                    chunkCoord.y * Chunk::CHUNK_HEIGHT,
-                    chunkCoord.z * Chunk::CHUNK_DEPTH
-                );
-
-                // activeChunks.try_emplace(chunkCoord, chunkWorldPos, this->densityProgram, this->mcCountProgram, this->mcEmitProgram);
-                genIn->push(GenJob{ {chunkCoord.x, chunkCoord.y, chunkCoord.z}, chunkWorldPos });
-                requestedKeys.insert(k);
-            }
-        }
-    }
-}
-
-void World::collectFinished() {
-    GenResult res;
-    while (genOut->try_pop(res)) {
-        // wait/poll once
-        GLenum r = glClientWaitSync(res.fence, 0, 0);
-        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) {
-            // spin
-            glClientWaitSync(res.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
-        }
-        glDeleteSync(res.fence);
-
-        GLuint totalVertices = res.totalVertices;
-        if (totalVertices == 0) {
-            glDeleteBuffers(1,&res.vertexSSBO);
-            glDeleteBuffers(1,&res.indirect);
-            glDeleteBuffers(1,&res.counterSSBO);
-            glDeleteBuffers(1,&res.densitySSBO);
-            glDeleteBuffers(1,&res.offsetsSSBO);
-            continue;
-        }
-
-        // buffer with known count from second pass
-        struct IndirectDraw { GLuint count, instanceCount, first, baseInstance; };
-        IndirectDraw cmd{ totalVertices, 1u, 0u, 0u };
-        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, res.indirect);
-        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(cmd), &cmd, GL_STATIC_DRAW);
-
-        // create VAO
-        GLuint vao=0;
-        glGenVertexArrays(1, &vao);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, res.vertexSSBO);
-
-        const GLsizei stride = 2 * sizeof(GLuint);
-
-        // location 0: aPos
-        glEnableVertexAttribArray(0);
-        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, stride, (void*)0);
-
-        // location 1: aNormal
-        glEnableVertexAttribArray(1);
-        glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, stride, (void*)(sizeof(GLuint)));
-
-        glBindVertexArray(0);
-
-        glm::ivec3 cc(res.key.x,res.key.y,res.key.z);
-        auto [it,inserted] = activeChunks.try_emplace(cc, res.worldPos);
-        it->second.adoptPrebuilt(vao, res.vertexSSBO, res.indirect);
-
-        glDeleteBuffers(1,&res.counterSSBO);
-        glDeleteBuffers(1,&res.densitySSBO);
-        glDeleteBuffers(1,&res.offsetsSSBO);
-    }
-}
-
-void World::render(unsigned int shaderProgram, const Frustum& frustum, GLint uModelLoc) {
-    for (auto& [coord, chunk] : activeChunks) {
-        glm::vec3 bmin = chunk.chunkPos;
-        glm::vec3 bmax = chunk.chunkPos + glm::vec3(Chunk::CHUNK_WIDTH, Chunk::CHUNK_HEIGHT, Chunk::CHUNK_DEPTH);
-        if (!aabb_in_frustum(bmin, bmax, frustum)) continue;
-
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), chunk.chunkPos);
-        glUniformMatrix4fv(uModelLoc, 1, GL_FALSE, &model[0][0]);
-        chunk.renderRaw();
-    }
-}
+#include "world.h"
+#include "chunk.h"
+#include "frustum.h"
+#include "chunk_renderer.h"
+#include "job_queues.h"
+#include "worker_types.h"
+#include "terrain.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+World::World(unsigned int densityProg, unsigned int mcCountProg, unsigned int mcEmitProg, GenJobQueue* jobIn, SPSCQueue<GenResult>* jobOut, GpuBufferPool* pool, ChunkRenderer* chunkRenderer, MeshCache* cache) : densityProgram(densityProg), mcCountProgram(mcCountProg), mcEmitProgram(mcEmitProg), genIn(jobIn), genOut(jobOut), buffers(pool), renderer(chunkRenderer), meshCache(cache) {
+    setViewDistance(viewDistance);
+}
+
+World::~World() {
+    finishStores(true);
+}
+
+namespace {
+    // calls fn for every chunk coordinate in the box [aMin, aMax] that lies
+    // outside [bMin, bMax]. walks a's x/y columns and, where a column passes
+    // through b, only the z runs on either side of it, so the cost is the
+    // difference plus one column face. an empty b (bMin > bMax) visits all of a
+    template<typename Fn>
+    void for_each_outside(const glm::ivec3& aMin, const glm::ivec3& aMax, const glm::ivec3& bMin, const glm::ivec3& bMax, Fn&& fn) {
+        auto inside = [](int v, int lo, int hi) { return v >= lo && v <= hi; };
+        bool bEmpty = bMin.x > bMax.x || bMin.y > bMax.y || bMin.z > bMax.z;
+        for (int x = aMin.x; x <= aMax.x; x++) {
+            bool xIn = !bEmpty && inside(x, bMin.x, bMax.x);
+            for (int y = aMin.y; y <= aMax.y; y++) {
+                bool yIn = xIn && inside(y, bMin.y, bMax.y);
+                if (yIn) {
+                    for (int z = aMin.z; z <= std::min(aMax.z, bMin.z - 1); z++) fn(glm::ivec3(x, y, z));
+                    for (int z = std::max(aMin.z, bMax.z + 1); z <= aMax.z; z++) fn(glm::ivec3(x, y, z));
+                } else {
+                    for (int z = aMin.z; z <= aMax.z; z++) fn(glm::ivec3(x, y, z));
+                }
+            }
+        }
+    }
+}
+
+void World::setViewDistance(int distance) {
+    viewDistance = distance;
+    hasStreamed = false;
+
+    size_t tracked = 0;
+    for (const LodRing& r : computeRings(glm::ivec3(0))) {
+        glm::ivec3 box = r.boxMax - r.boxMin + 1;
+        glm::ivec3 hole = glm::max(r.holeMax - r.holeMin + 1, glm::ivec3(0));
+        tracked += size_t(box.x) * box.y * box.z - size_t(hole.x) * hole.y * hole.z;
+    }
+    chunks.reserve(tracked);
+}
+
+bool World::LodRing::inBox(const glm::ivec3& c) const {
+    return c.x >= boxMin.x && c.y >= boxMin.y && c.z >= boxMin.z
+        && c.x <= boxMax.x && c.y <= boxMax.y && c.z <= boxMax.z;
+}
+
+bool World::LodRing::inHole(const glm::ivec3& c) const {
+    return c.x >= holeMin.x && c.y >= holeMin.y && c.z >= holeMin.z
+        && c.x <= holeMax.x && c.y <= holeMax.y && c.z <= holeMax.z;
+}
+
+namespace {
+    // lod 0 chunk coordinate -> coordinate of the lod chunk containing it
+    glm::ivec3 coarsen(const glm::ivec3& c, int lod) {
+        return glm::ivec3(c.x >> lod, c.y >> lod, c.z >> lod);
+    }
+}
+
+World::LodRings World::computeRings(const glm::ivec3& center) const {
+    // top-down: the coarsest level is a box around the player, and every
+    // level's box is exactly the children of the hole in the level above, so
+    // the rings tile space without overlap at any player position
+    LodRings r;
+    constexpr int TOP = Config::LOD_LEVELS - 1;
+    const glm::ivec3 extent(viewDistance, Config::VERTICAL_VIEW_DISTANCE, viewDistance);
+    const glm::ivec3 hole(Config::LOD_RING_RADIUS, Config::LOD_RING_RADIUS_Y, Config::LOD_RING_RADIUS);
+
+    glm::ivec3 top = coarsen(center, TOP);
+    r[TOP].boxMin = top - extent;
+    r[TOP].boxMax = top + extent;
+    for (int lod = TOP; lod > 0; --lod) {
+        glm::ivec3 c = coarsen(center, lod);
+        r[lod].holeMin = c - hole;
+        r[lod].holeMax = c + hole;
+        r[lod - 1].boxMin = r[lod].holeMin * 2;
+        r[lod - 1].boxMax = r[lod].holeMax * 2 + 1;
+    }
+    return r;
+}
+
+void World::update(const glm::vec3& playerPos, const glm::vec3& viewDir) {
+    glm::ivec3 playerChunkCoord(
+        floor(playerPos.x / Chunk::CHUNK_WIDTH),
+        floor(playerPos.y / Chunk::CHUNK_HEIGHT),
+        floor(playerPos.z / Chunk::CHUNK_DEPTH)
+    );
+
+    // re-sort queued jobs when the player enters another chunk or turns more than ~15 degrees
+    constexpr float REFOCUS_COS = 0.966f;
+    if (!hasFocus || playerChunkCoord != focusChunk || glm::dot(viewDir, focusDir) < REFOCUS_COS) {
+        genIn->setFocus(playerPos, viewDir);
+        hasFocus = true;
+        focusChunk = playerChunkCoord;
+        focusDir = viewDir;
+    }
+
+    if (hasStreamed && playerChunkCoord == streamCenter) {
+        if (!retiring.empty()) {
+            retireChunks();
+        }
+        return;
+    }
+
+    LodRings next = computeRings(playerChunkCoord);
+    if (hasStreamed) {
+        // the map only ever holds the rings around streamCenter, so a step only
+        // touches the slabs that leave and enter each level's box and hole
+        const LodRings prev = rings;
+        rings = next;
+        for (int lod = 0; lod < Config::LOD_LEVELS; ++lod) {
+            const LodRing& o = prev[lod];
+            const LodRing& n = rings[lod];
+            for_each_outside(o.boxMin, o.boxMax, n.boxMin, n.boxMax, [&](const glm::ivec3& c){
+                if (!o.inHole(c)) dropChunk(c, lod);
+            });
+            for_each_outside(n.holeMin, n.holeMax, o.holeMin, o.holeMax, [&](const glm::ivec3& c){
+                if (o.inBox(c)) dropChunk(c, lod);
+            });
+            for_each_outside(n.boxMin, n.boxMax, o.boxMin, o.boxMax, [&](const glm::ivec3& c){
+                if (!n.inHole(c)) requestChunk(c, lod);
+            });
+            for_each_outside(o.holeMin, o.holeMax, n.holeMin, n.holeMax, [&](const glm::ivec3& c){
+                if (n.inBox(c)) requestChunk(c, lod);
+            });
+
+            // seams only change for chunks next to a face of the old or new box
+            if (Config::LOD_STITCH_SEAMS && lod < Config::LOD_LEVELS - 1) {
+                auto refresh = [&](const glm::ivec3& c){
+                    if (!n.contains(c)) return;
+                    if (ChunkMap::Entry* entry = chunks.find(ChunkKey{ c.x, c.y, c.z, lod })) {
+                        refreshSeams(*entry);
+                    }
+                };
+                for_each_outside(o.boxMin, o.boxMax, o.boxMin + 1, o.boxMax - 1, refresh);
+                for_each_outside(n.boxMin, n.boxMax, n.boxMin + 1, n.boxMax - 1, refresh);
+            }
+        }
+    } else {
+        // first frame or view distance change: rebuild from scratch
+        rings = next;
+        std::vector<ChunkKey> unloadChunks;
+        for (auto& entry : chunks) {
+            const ChunkKey& k = entry.coord;
+            if (!rings[k.lod].contains(glm::ivec3(k.x, k.y, k.z))) {
+                unloadChunks.push_back(k);
+            }
+        }
+        for (const ChunkKey& k : unloadChunks) {
+            dropChunk(glm::ivec3(k.x, k.y, k.z), k.lod);
+        }
+        for (int lod = 0; lod < Config::LOD_LEVELS; ++lod) {
+            const LodRing& n = rings[lod];
+            for_each_outside(n.boxMin, n.boxMax, n.holeMin, n.holeMax, [&](const glm::ivec3& c){ requestChunk(c, lod); });
+        }
+    }
+
+    streamCenter = playerChunkCoord;
+    hasStreamed = true;
+    retireChunks();
+}
+
+void World::requestChunk(const glm::ivec3& chunkCoord, int lod) {
+    long long k = key64(chunkCoord.x, chunkCoord.y, chunkCoord.z, lod);
+    if (ChunkMap::Entry* existing = chunks.find(k)) {
+        // wanted again while retiring; the rings may have moved its seams
+        refreshSeams(*existing);
+        return;
+    }
+
+    glm::vec3 chunkWorldPos = glm::vec3(
+        chunkCoord.x * Chunk::CHUNK_WIDTH,
+        chunkCoord.y * Chunk::CHUNK_HEIGHT,
+        chunkCoord.z * Chunk::CHUNK_DEPTH
+    ) * lod_scale(lod);
+
+    ChunkKey key{chunkCoord.x, chunkCoord.y, chunkCoord.z, lod};
+    ChunkMap::Entry& entry = chunks.insert(key, chunkWorldPos);
+    entry.seams = seamMask(chunkCoord, lod);
+    queueJob(entry, 0);
+}
+
+void World::queueJob(ChunkMap::Entry& entry, uint32_t slotHint) {
+    const ChunkKey& k = entry.coord;
+    if (edits && edits->find(k)) {
+        // sculpted: the noise (and its bounds) no longer describe it
+        edits->markDirty(k);
+        return;
+    }
+    if (Config::GEN_SKIP_BOUNDED
+        && Terrain::bound_occupancy(entry.chunk.chunkPos, lod_scale(k.lod), Config::TERRAIN_MODE) != Terrain::Occupancy::Unknown) {
+        // all air or all rock whatever the noise does, so no surface (and no
+        // seam either); the same holds for every later request of it
+        entry.state = ChunkMap::State::Empty;
+        entry.remeshing = false;
+        counters.jobsSkipped++;
+        return;
+    }
+    if (meshCache && adoptCached(entry)) {
+        counters.cacheHits++;
+        return;
+    }
+    counters.jobsQueued++;
+    genIn->push(GenJob{ k, entry.chunk.chunkPos, slotHint, entry.seams });
+}
+
+uint8_t World::seamMask(const glm::ivec3& chunkCoord, int lod) const {
+    if (!Config::LOD_STITCH_SEAMS || lod == Config::LOD_LEVELS - 1) return 0;
+
+    // a box is the children of the coarser level's hole, so a neighbour
+    // outside it belongs to the coarser level
+    uint8_t mask = 0;
+    for (int face = 0; face < 6; ++face) {
+        glm::ivec3 n = chunkCoord;
+        n[face >> 1] += (face & 1) ? 1 : -1;
+        if (!rings[lod].inBox(n)) {
+            mask |= uint8_t(1u << face);
+        }
+    }
+    return mask;
+}
+
+void World::refreshSeams(ChunkMap::Entry& entry) {
+    const ChunkKey& k = entry.coord;
+    uint8_t mask = seamMask(glm::ivec3(k.x, k.y, k.z), k.lod);
+    if (mask == entry.seams) return;
+
+    // supersedes a queued job; a result already in flight is dropped by adoptResult.
+    // a built chunk keeps drawing its old mesh until the new one arrives
+    entry.seams = mask;
+    if (entry.state != ChunkMap::State::Requested) {
+        entry.remeshing = true;
+    }
+    queueJob(entry, 0);
+}
+
+void World::dropChunk(const glm::ivec3& chunkCoord, int lod) {
+    ChunkKey key{chunkCoord.x, chunkCoord.y, chunkCoord.z, lod};
+    ChunkMap::Entry* entry = chunks.find(key);
+    if (!entry) return;
+
+    // a job for a chunk that left the range before it was built gets cancelled
+    if (entry->state == ChunkMap::State::Requested || entry->remeshing) {
+        genIn->cancel(key);
+        entry->remeshing = false;
+    }
+    if (entry->state == ChunkMap::State::Loaded) {
+        retiring.push_back(key);
+        return;
+    }
+    chunks.erase(key);
+}
+
+bool World::spaceReady(const ChunkKey& key) {
+    const glm::ivec3 c(key.x, key.y, key.z);
+    const LodRing& r = rings[key.lod];
+    if (r.contains(c)) {
+        ChunkMap::Entry* entry = chunks.find(key);
+        return entry && entry->state != ChunkMap::State::Requested;
+    }
+    if (r.inBox(c)) {
+        // in the hole: the finer level covers it with 8 children
+        for (int i = 0; i < 8; ++i) {
+            ChunkKey child{ 2 * key.x + (i & 1), 2 * key.y + ((i >> 1) & 1), 2 * key.z + ((i >> 2) & 1), key.lod - 1 };
+            if (!spaceReady(child)) return false;
+        }
+        return true;
+    }
+    // outside the box: covered by the coarser parent, or by nothing at all
+    if (key.lod == Config::LOD_LEVELS - 1) return true;
+    glm::ivec3 parent = glm::ivec3(key.x >> 1, key.y >> 1, key.z >> 1);
+    return spaceReady(ChunkKey{ parent.x, parent.y, parent.z, key.lod + 1 });
+}
+
+void World::retireChunks() {
+    for (size_t i = 0; i < retiring.size();) {
+        const ChunkKey key = retiring[i];
+        ChunkMap::Entry* entry = chunks.find(key);
+        bool done = true;
+        if (entry && !rings[key.lod].contains(glm::ivec3(key.x, key.y, key.z))) {
+            // wanted again means done too: it just stays
+            done = spaceReady(key);
+            if (done) {
+                chunks.erase(key);
+            }
+        }
+        if (done) {
+            retiring[i] = retiring.back();
+            retiring.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+namespace {
+    bool fence_signalled(GLsync fence) {
+        GLenum r = glClientWaitSync(fence, 0, 0);
+        return r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED;
+    }
+}
+
+bool World::adoptCached(ChunkMap::Entry& entry) {
+    MeshCache::Mesh mesh;
+    if (!meshCache->find(entry.coord, entry.seams, mesh)) return false;
+
+    // a job queued for an older seam mask is not needed any more; one already
+    // in flight is dropped by adoptResult
+    genIn->cancel(entry.coord);
+    entry.remeshing = false;
+    if (mesh.indexCount == 0) {
+        entry.chunk.release();
+        entry.state = ChunkMap::State::Empty;
+        return true;
+    }
+
+    // straight from the region's mapping into a slab range
+    const uint32_t slots = mesh_slots(mesh.vertexCount, mesh.indexCount);
+    VertexRange range = buffers->allocVertices(slots);
+    glBindBuffer(GL_ARRAY_BUFFER, range.buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, GLintptr(range.first) * GLintptr(sizeof(glm::uvec2)),
+                    GLsizeiptr(slots) * GLsizeiptr(sizeof(glm::uvec2)), mesh.data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    entry.state = ChunkMap::State::Loaded;
+    entry.chunk.adoptMesh(range, mesh.vertexCount, mesh.indexCount, buffers, renderer);
+    return true;
+}
+
+void World::queueStore(const GenResult& res, uint32_t totalVertices, uint32_t totalIndices) {
+    // a gpu-side copy, so reading the mesh back never waits on the slab, which
+    // the worker may still be emitting other chunks into
+    const GLsizeiptr bytes = GLsizeiptr(mesh_slots(totalVertices, totalIndices)) * GLsizeiptr(sizeof(glm::uvec2));
+    PendingStore p{ res.key, res.seams, totalVertices, totalIndices };
+    glGenBuffers(1, &p.staging);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, p.staging);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_COPY_READ_BUFFER, res.vertices.buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                        GLintptr(res.vertices.first) * GLintptr(sizeof(glm::uvec2)), 0, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    storing.push_back(p);
+}
+
+void World::finishStores(bool wait) {
+    for (size_t i = 0; i < storing.size();) {
+        PendingStore& p = storing[i];
+        if (!wait && !fence_signalled(p.fence)) {
+            ++i;
+            continue;
+        }
+        glClientWaitSync(p.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+        glDeleteSync(p.fence);
+
+        const GLsizeiptr bytes = GLsizeiptr(mesh_slots(p.vertexCount, p.indexCount)) * GLsizeiptr(sizeof(glm::uvec2));
+        glBindBuffer(GL_COPY_READ_BUFFER, p.staging);
+        if (const void* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+            const glm::uvec2* vertices = static_cast<const glm::uvec2*>(mapped);
+            meshCache->store(p.key, p.seams, vertices, p.vertexCount,
+                             reinterpret_cast<const uint32_t*>(vertices + p.vertexCount), p.indexCount);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &p.staging);
+
+        storing[i] = storing.back();
+        storing.pop_back();
+    }
+}
+
+void World::collectFinished() {
+    if (!storing.empty()) {
+        finishStores(false);
+    }
+
+    // results still running on the gpu last frame
+    for (size_t i = 0; i < unsignalled.size();) {
+        if (fence_signalled(unsignalled[i].fence)) {
+            adoptResult(unsignalled[i]);
+            unsignalled.erase(unsignalled.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+
+    // drain in batches: one index store per batch frees the producer's slots
+    constexpr size_t BATCH = 16;
+    GenResult batch[BATCH];
+    size_t n;
+    while ((n = genOut->pop_batch(batch, BATCH)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            // poll once (cpu backend results carry no fence); the gpu worker no longer
+            // waits before handing results over, so park unfinished ones for next frame
+            if (batch[i].fence && !fence_signalled(batch[i].fence)) {
+                unsignalled.push_back(std::move(batch[i]));
+                continue;
+            }
+            adoptResult(batch[i]);
+        }
+    }
+}
+
+void World::adoptResult(GenResult& res) {
+    if (res.fence) {
+        glDeleteSync(res.fence);
+        res.fence = 0;
+    }
+
+    GLuint totalVertices = res.totalVertices;
+    GLuint totalIndices = res.totalIndices;
+    if (res.countOnGpu) {
+        // lazy count readback: the fence has signalled, so this does not stall
+        GLuint totals[2] = { 0, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, res.counterSSBO);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(totals), totals);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        totalVertices = totals[0];
+        totalIndices = totals[1];
+    }
+    const uint32_t slots = mesh_slots(totalVertices, totalIndices);
+
+    // the gpu is done with the scratch buffers
+    buffers->release(GpuBufferPool::Kind::Density, res.densitySSBO);
+    buffers->release(GpuBufferPool::Kind::Offsets, res.offsetsSSBO);
+    buffers->release(GpuBufferPool::Kind::Counter, res.counterSSBO);
+
+    // chunk may have left the range while its job was in flight, or its seams
+    // changed and a newer job is on the way
+    ChunkMap::Entry* entry = chunks.find(res.key);
+    bool wanted = entry && (entry->state == ChunkMap::State::Requested || entry->remeshing)
+               && res.seams == entry->seams && !(edits && edits->find(res.key));
+
+    if (wanted && res.countOnGpu && slots > res.vertices.count) {
+        // overflowed the pre-sized range: regenerate with room for the measured size
+        buffers->freeVertices(res.vertices);
+        queueJob(*entry, slots);
+        return;
+    }
+
+    if (totalIndices == 0 || !wanted) {
+        buffers->freeVertices(res.vertices);
+        if (wanted && meshCache) {
+            meshCache->store(res.key, res.seams, nullptr, 0, nullptr, 0);
+        }
+        if (wanted) {
+            entry->chunk.release(); // remeshed to nothing
+            entry->state = ChunkMap::State::Empty;
+            entry->remeshing = false;
+        }
+        return;
+    }
+
+    if (!res.cpuVertices.empty()) {
+        // cpu backend: upload the packed stream and its indices into a slab range
+        res.vertices = buffers->allocVertices(slots);
+        GLintptr vertexBytes = GLintptr(res.cpuVertices.size() * sizeof(glm::uvec2));
+        GLintptr first = GLintptr(res.vertices.first) * GLintptr(sizeof(glm::uvec2));
+        glBindBuffer(GL_ARRAY_BUFFER, res.vertices.buffer);
+        glBufferSubData(GL_ARRAY_BUFFER, first, vertexBytes, res.cpuVertices.data());
+        glBufferSubData(GL_ARRAY_BUFFER, first + vertexBytes, GLsizeiptr(res.cpuIndices.size() * sizeof(uint32_t)), res.cpuIndices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (meshCache) {
+            meshCache->store(res.key, res.seams, res.cpuVertices.data(), totalVertices, res.cpuIndices.data(), totalIndices);
+        }
+    } else if (meshCache) {
+        queueStore(res, totalVertices, totalIndices);
+    }
+    if (res.countOnGpu) {
+        // hand back the unused tail of the pre-sized range
+        res.vertices = buffers->shrinkVertices(res.vertices, slots);
+    }
+
+    entry->state = ChunkMap::State::Loaded;
+    entry->remeshing = false;
+    entry->chunk.adoptMesh(res.vertices, totalVertices, totalIndices, buffers, renderer);
+}
+
+void World::enableEditing(TerrainEdits* edits_, EditRemesher* remesher_) {
+    edits = edits_;
+    remesher = remesher_;
+}
+
+void World::applyBrush(const Brush& brush) {
+    if (!edits) return;
+    if (!editPending) {
+        editStart = std::chrono::steady_clock::now();
+    }
+    editPending |= edits->apply(brush) > 0;
+}
+
+void World::remeshEdited() {
+    if (!edits) return;
+    dirtyChunks.clear();
+    edits->takeDirty(dirtyChunks);
+    if (dirtyChunks.empty()) return;
+
+    remeshRequests.clear();
+    for (const ChunkKey& key : dirtyChunks) {
+        ChunkMap::Entry* entry = chunks.find(key);
+        if (!entry) continue; // out of range: remeshed once it is requested again
+        remeshRequests.push_back(EditRemesher::Request{ key, entry->seams });
+    }
+    remesher->remesh(*edits, remeshRequests, remeshed);
+
+    for (size_t i = 0; i < remeshRequests.size(); ++i) {
+        const ChunkKey& key = remeshRequests[i].key;
+        ChunkMap::Entry* entry = chunks.find(key);
+        const EditRemesher::Mesh& mesh = remeshed[i];
+        genIn->cancel(key); // a job queued before the first edit
+        entry->remeshing = false;
+        if (mesh.indexCount == 0) {
+            entry->chunk.release();
+            entry->state = ChunkMap::State::Empty;
+        } else {
+            entry->state = ChunkMap::State::Loaded;
+            entry->chunk.adoptMesh(mesh.vertices, mesh.vertexCount, mesh.indexCount, buffers, renderer);
+        }
+    }
+    counters.chunksRemeshed += remeshRequests.size();
+
+    if (editPending) {
+        counters.lastEditMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - editStart).count();
+        counters.maxEditMs = std::max(counters.maxEditMs, counters.lastEditMs);
+        editPending = false;
+    }
+}
+
+void World::render(const Frustum& frustum, const HiZPyramid* occluders) {
+    if (Config::GPU_CULLING) {
+        renderer->drawCulled(frustum, occluders);
+        return;
+    }
+
+    renderer->begin();
+    for (auto& entry : chunks) {
+        if (entry.state != ChunkMap::State::Loaded) continue;
+        Chunk& chunk = entry.chunk;
+        glm::vec3 bmin = chunk.chunkPos;
+        glm::vec3 bmax = chunk.chunkPos + glm::vec3(Chunk::CHUNK_WIDTH, Chunk::CHUNK_HEIGHT, Chunk::CHUNK_DEPTH) * chunk.voxelScale;
+        if (!aabb_in_frustum(bmin, bmax, frustum)) continue;
+
+        renderer->add(chunk.renderSlot());
+    }
+    renderer->submit();
+}
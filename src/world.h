@@ -1,53 +1,158 @@
 #pragma once
 
-#include <map>
-#include <unordered_set>
+#include <array>
+#include <chrono>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "frustum.h"
 #include "chunk.h"
+#include "chunk_map.h"
 #include "job_queues.h"
+#include "gen_job_queue.h"
+#include "gpu_buffer_pool.h"
+#include "mesh_cache.h"
+#include "edit_remesher.h"
+#include "terrain_edits.h"
+#include "chunk_renderer.h"
 #include "worker_types.h"
 #include "config.h"
 
-struct Vec3Compare {
-    bool operator()(const glm::ivec3& a, const glm::ivec3& b) const {
-        if (a.x < b.x) return true;
-        if (a.x > b.x) return false;
-        if (a.y < b.y) return true;
-        if (a.y > b.y) return false;
-        if (a.z < b.z) return true;
-        if (a.z > b.z) return false;
-        return false;
-    }
-};
-
 class World {
 public:
-    World(unsigned int densityProgram, unsigned int mcCountProgram, unsigned int mcEmitProgram, BlockingQueue<GenJob>* jobIn, SPSCQueue<GenResult>* jobOut);
+    // meshCache: optional, see Config::MESH_CACHE
+    World(unsigned int densityProgram, unsigned int mcCountProgram, unsigned int mcEmitProgram, GenJobQueue* jobIn, SPSCQueue<GenResult>* jobOut, GpuBufferPool* pool, ChunkRenderer* chunkRenderer, MeshCache* meshCache = nullptr);
+    // writes the meshes still being read back into the cache
+    ~World();
 
-    // check player position and load/unload chunks
-    void update(const glm::vec3& playerPos);
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // check player position and load/unload chunks; viewDir steers which
+    // missing chunks get generated first
+    void update(const glm::vec3& playerPos, const glm::vec3& viewDir);
 
     void collectFinished();
 
-    // render all loaded chunks
-    void render(unsigned int shaderProgram, const Frustum& frustum, GLint uModelLoc);
+    // sculpting: edited lod 0 chunks are meshed on this thread with edits'
+    // overlay, never by the generator or from the mesh cache
+    void enableEditing(TerrainEdits* edits, EditRemesher* remesher);
+    // changes the terrain; the chunks it touched are remeshed by remeshEdited()
+    void applyBrush(const Brush& brush);
+    // remeshes the chunks changed since the last call, in time for this frame's render
+    void remeshEdited();
+
+    // horizontal radius of the coarsest lod level, in its chunks (vertical is
+    // Config::VERTICAL_VIEW_DISTANCE)
+    void setViewDistance(int distance);
+    int getViewDistance() const { return viewDistance; }
+
+    // chunks tracked across all lod levels: loaded, empty, pending or retiring
+    size_t chunkCount() const { return chunks.size(); }
+
+    struct Stats {
+        uint64_t jobsQueued = 0;  // generation jobs pushed, including remeshes and retries
+        uint64_t jobsSkipped = 0; // chunks marked empty up front (Config::GEN_SKIP_BOUNDED)
+        uint64_t cacheHits = 0;   // chunks taken from the mesh cache instead of generated
+        uint64_t chunksRemeshed = 0; // edited chunks meshed by remeshEdited()
+        // first brush since the last remeshEdited() until its meshes were
+        // submitted, cpu wall time including the wait for the counts
+        double lastEditMs = 0.0;
+        double maxEditMs = 0.0;
+    };
+    const Stats& stats() const { return counters; }
+
+    // render all loaded chunks in the frustum and, with GPU_CULLING, not hidden
+    // behind occluders; expects the terrain program bound
+    void render(const Frustum& frustum, const HiZPyramid* occluders = nullptr);
 
 private:
     // currently loaded chunks
-    std::map<glm::ivec3, Chunk, Vec3Compare> activeChunks;
-    std::unordered_set<long long> requestedKeys;
+    // loaded chunks and chunks whose generation job is still pending
+    ChunkMap chunks;
+
+    // player chunk / view direction the job queue was last sorted for
+    bool hasFocus = false;
+    glm::ivec3 focusChunk{0};
+    glm::vec3 focusDir{0.0f, 0.0f, -1.0f};
 
     int viewDistance = Config::VIEW_DISTANCE;
 
+    // chunks wanted at one lod: the box minus the hole the next finer level
+    // fills, in that lod's chunk coordinates. bounds are inclusive
+    struct LodRing {
+        glm::ivec3 boxMin{0}, boxMax{-1};
+        glm::ivec3 holeMin{0}, holeMax{-1};
+
+        bool inBox(const glm::ivec3& c) const;
+        bool inHole(const glm::ivec3& c) const;
+        bool contains(const glm::ivec3& c) const { return inBox(c) && !inHole(c); }
+    };
+    using LodRings = std::array<LodRing, Config::LOD_LEVELS>;
+
+    // player chunk (lod 0) the tracked rings are centred on
+    bool hasStreamed = false;
+    glm::ivec3 streamCenter{0};
+    LodRings rings;
+
+    // loaded chunks no longer wanted, still drawn until the chunks replacing
+    // them are built so lod changes never open holes
+    std::vector<ChunkKey> retiring;
+
+    LodRings computeRings(const glm::ivec3& center) const;
+    void requestChunk(const glm::ivec3& chunkCoord, int lod);
+    // faces of a wanted chunk that border the next coarser level
+    uint8_t seamMask(const glm::ivec3& chunkCoord, int lod) const;
+    // regenerates entry when the rings changed which of its faces are seams
+    void refreshSeams(ChunkMap::Entry& entry);
+    // queues a generation job, unless the terrain bounds prove the chunk has
+    // no surface; then it is marked Empty right away
+    void queueJob(ChunkMap::Entry& entry, uint32_t slotHint);
+    // turns a finished generation result into a loaded (or empty) chunk
+    void adoptResult(GenResult& res);
+    // loads entry from the mesh cache if it holds a mesh for its seams
+    bool adoptCached(ChunkMap::Entry& entry);
+    // starts copying an adopted gpu mesh out of its slab range for the cache
+    void queueStore(const GenResult& res, uint32_t totalVertices, uint32_t totalIndices);
+    // hands the copies that have arrived (all of them with wait) to the cache
+    void finishStores(bool wait);
+    void dropChunk(const glm::ivec3& chunkCoord, int lod);
+    // true once every wanted chunk overlapping key's space has been built
+    bool spaceReady(const ChunkKey& key);
+    void retireChunks();
+
     unsigned int densityProgram;
     unsigned int mcCountProgram;
     unsigned int mcEmitProgram;
 
-    BlockingQueue<GenJob>* genIn = nullptr;
+    GenJobQueue* genIn = nullptr;
     SPSCQueue<GenResult>* genOut = nullptr;
+    GpuBufferPool* buffers = nullptr;
+    ChunkRenderer* renderer = nullptr;
+
+    // results popped before their fence signalled
+    std::vector<GenResult> unsignalled;
+
+    MeshCache* meshCache = nullptr;
+    // gpu meshes on their way to the cache: a copy of the slab range in a
+    // staging buffer, read once its fence signalled
+    struct PendingStore {
+        ChunkKey key;
+        uint8_t seams = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        GLuint staging = 0;
+        GLsync fence = 0;
+    };
+    std::vector<PendingStore> storing;
+
+    TerrainEdits* edits = nullptr;
+    EditRemesher* remesher = nullptr;
+    bool editPending = false;
+    std::chrono::steady_clock::time_point editStart; // first brush not remeshed yet
+    std::vector<ChunkKey> dirtyChunks;
+    std::vector<EditRemesher::Request> remeshRequests;
+    std::vector<EditRemesher::Mesh> remeshed;
 
-    // FIX THIS: check for better alternative
-    static long long key64(int x,int y,int z){ return ( ( (long long)x & 0x1FFFFF)<<42 ) | ( ((long long)y & 0x1FFFFF)<<21 ) | ((long long)z & 0x1FFFFF); }
+    Stats counters;
 };
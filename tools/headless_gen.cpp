@@ -0,0 +1,217 @@
+// headless chunk generation with the cpu backend: no window or GL context
+// needed, so it runs on batch/CI machines to pre-generate worlds and to
+// measure generation throughput.
+//
+// usage: terrain_headless [viewDistance] [workers, 0 = all] [output file]
+//        terrain_headless seams   (checks lod seams are watertight, see below)
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "chunk_scheduler.h"
+#include "cpu_backend.h"
+#include "gen_job_queue.h"
+#include "job_queues.h"
+#include "snoise.h"
+#include "worker_types.h"
+
+namespace {
+    // a point in lod 0 position steps (CHUNK_WIDTH / 1022 world units, what
+    // pack_position quantizes to), so meshes of any lod compare exactly
+    using Point = std::array<long long, 3>;
+    using Edge = std::pair<Point, Point>;
+
+    Point world_point(uint32_t packed, const ChunkKey& key) {
+        const int chunk[3] = { key.x, key.y, key.z };
+        Point p;
+        for (int a = 0; a < 3; ++a) {
+            long long q = (packed >> (10 * a)) & 1023u;
+            p[a] = (q + chunk[a] * 1022ll) << key.lod;
+        }
+        return p;
+    }
+
+    // toggles the mesh's triangle edges lying in the plane p[axis] == plane
+    // in edges, endpoints ordered: what is left after every chunk along the
+    // plane is the surface's boundary there, the edges an odd number of
+    // triangles use. edges around vertices that only round onto the plane
+    // pair up and drop out, as do collapsed ones
+    void toggle_plane_edges(std::set<Edge>& edges, const ChunkKey& key, const std::vector<glm::uvec2>& vertices,
+                            const std::vector<uint32_t>& indices, int axis, long long plane) {
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                Point a = world_point(vertices[indices[t + k]].x, key);
+                Point b = world_point(vertices[indices[t + (k + 1) % 3]].x, key);
+                if (a[axis] != plane || b[axis] != plane || a == b) continue;
+                Edge e = a < b ? Edge{ a, b } : Edge{ b, a };
+                if (!edges.insert(e).second) edges.erase(e);
+            }
+        }
+    }
+
+    GenJob job_for(const ChunkKey& key, uint8_t seams) {
+        GenJob job{ key, glm::vec3(key.x, key.y, key.z) * float(Config::CHUNK_WIDTH) * lod_scale(key.lod) };
+        job.seams = seams;
+        return job;
+    }
+
+    // the lod 1 chunks checked, [lo, hi) per axis
+    constexpr int COARSE_LO[3] = { -2, -1, -2 };
+    constexpr int COARSE_HI[3] = { 2, 1, 2 };
+
+    // meshes layers of lod 1 chunks and the lod 0 chunks against each of
+    // their faces with the cpu backend, and checks that the surface boundary
+    // in the seam plane is the same on both sides: the fine chunks' stitched
+    // faces and the coarse ones' must meet without holes. returns the number
+    // of unmatched edges
+    size_t check_seams(int terrainMode) {
+        CpuChunkBackend backend(terrainMode);
+        std::vector<glm::uvec2> vertices;
+        std::vector<uint32_t> indices;
+        size_t layers = 0, shared = 0, unmatched = 0;
+
+        for (int face = 0; face < 6; ++face) {
+            const int axis = face >> 1;
+            const int side = face & 1;
+            const int ua = (axis + 1) % 3;
+            const int wa = (axis + 2) % 3;
+
+            for (int layer = COARSE_LO[axis]; layer < COARSE_HI[axis]; ++layer) {
+                const long long plane = (layer + side) * 2044ll;
+                std::set<Edge> coarseEdges, fineEdges;
+
+                for (int u = COARSE_LO[ua]; u < COARSE_HI[ua]; ++u) {
+                    for (int w = COARSE_LO[wa]; w < COARSE_HI[wa]; ++w) {
+                        int c[3];
+                        c[axis] = layer;
+                        c[ua] = u;
+                        c[wa] = w;
+                        const ChunkKey coarse{ c[0], c[1], c[2], 1 };
+                        backend.generate(job_for(coarse, 0), vertices, indices);
+                        toggle_plane_edges(coarseEdges, coarse, vertices, indices, axis, plane);
+
+                        // the four fine chunks on the other side, their opposite face a seam
+                        for (int q = 0; q < 4; ++q) {
+                            int f[3];
+                            f[axis] = side ? 2 * layer + 2 : 2 * layer - 1;
+                            f[ua] = 2 * u + (q & 1);
+                            f[wa] = 2 * w + (q >> 1);
+                            const ChunkKey fine{ f[0], f[1], f[2], 0 };
+                            backend.generate(job_for(fine, uint8_t(1u << (2 * axis + (1 - side)))), vertices, indices);
+                            toggle_plane_edges(fineEdges, fine, vertices, indices, axis, plane);
+                        }
+                    }
+                }
+
+                // edges along the layer's rim pair up with chunks outside it
+                auto onRim = [&](const Edge& e) {
+                    for (int a : { ua, wa }) {
+                        for (long long rim : { COARSE_LO[a] * 2044ll, COARSE_HI[a] * 2044ll }) {
+                            if (e.first[a] == rim && e.second[a] == rim) return true;
+                        }
+                    }
+                    return false;
+                };
+                for (const Edge& e : coarseEdges) {
+                    if (onRim(e)) continue;
+                    if (fineEdges.count(e)) {
+                        shared++;
+                    } else {
+                        unmatched++;
+                    }
+                }
+                for (const Edge& e : fineEdges) {
+                    if (!onRim(e) && !coarseEdges.count(e)) unmatched++;
+                }
+                layers++;
+            }
+        }
+        std::printf("terrainMode %d: %zu seam layers, %zu edges shared, %zu unmatched\n",
+                    terrainMode, layers, shared, unmatched);
+        return unmatched;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "seams") == 0) {
+        size_t unmatched = check_seams(0) + check_seams(1);
+        return unmatched == 0 ? 0 : 1;
+    }
+
+    int viewDistance = argc > 1 ? std::atoi(argv[1]) : Config::VIEW_DISTANCE;
+    unsigned workers = argc > 2 ? unsigned(std::atoi(argv[2])) : Config::GEN_WORKER_THREADS;
+    const char* outPath = argc > 3 ? argv[3] : nullptr;
+
+    std::ofstream out;
+    if (outPath) {
+        out.open(outPath, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open output file " << outPath << "\n";
+            return 1;
+        }
+        // header: magic, then one record per chunk (x, y, z, vertex count, index
+        // count, packed uvec2 vertices, uint32 indices)
+        out.write("TMSH", 4);
+    }
+
+    GenJobQueue genIn;
+    SPSCQueue<GenResult> genOut;
+    ChunkScheduler scheduler(&genIn, &genOut, workers);
+
+    size_t jobs = 0;
+    for (int x = -viewDistance; x <= viewDistance; x++) {
+        for (int y = -4; y <= 4; y++) {
+            for (int z = -viewDistance; z <= viewDistance; z++) {
+                genIn.push(GenJob{ {x, y, z}, glm::vec3(x * Config::CHUNK_WIDTH, y * Config::CHUNK_HEIGHT, z * Config::CHUNK_DEPTH) });
+                jobs++;
+            }
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    scheduler.start();
+
+    size_t received = 0;
+    GenResult res;
+    while (received < jobs) {
+        if (!genOut.try_pop(res)) {
+            std::this_thread::yield();
+            continue;
+        }
+        received++;
+        if (out.is_open()) {
+            int32_t header[5] = { res.key.x, res.key.y, res.key.z, int32_t(res.totalVertices), int32_t(res.totalIndices) };
+            out.write(reinterpret_cast<const char*>(header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(res.cpuVertices.data()), std::streamsize(res.cpuVertices.size() * sizeof(glm::uvec2)));
+            out.write(reinterpret_cast<const char*>(res.cpuIndices.data()), std::streamsize(res.cpuIndices.size() * sizeof(uint32_t)));
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+    scheduler.shutdown();
+    ChunkScheduler::Stats stats = scheduler.stats();
+
+    std::printf("noise kernel: %s, workers: %u\n", snoise_isa(), scheduler.workerCount());
+    std::printf("chunks: %llu (%llu empty), vertices: %llu\n",
+                (unsigned long long)stats.chunksDone, (unsigned long long)stats.emptyChunks, (unsigned long long)stats.vertices);
+    std::printf("time: %.3f s, %.1f chunks/s, %.2f ms/chunk\n", seconds, jobs / seconds, 1000.0 * seconds / jobs);
+    for (size_t i = 0; i < stats.workers.size(); ++i) {
+        const auto& w = stats.workers[i];
+        std::printf("  worker %2zu: %6llu tasks (%llu stolen), busy %.1f%%, %llu sleeps\n", i,
+                    (unsigned long long)w.executed, (unsigned long long)w.stolen,
+                    100.0 * double(w.busyNs) * 1e-9 / seconds, (unsigned long long)w.sleeps);
+    }
+    return 0;
+}